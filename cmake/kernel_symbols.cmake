@@ -0,0 +1,71 @@
+# the inline functions of a kernel object (std::sqrt, std::max, kernel::selected, ...) are weak symbols
+# compiled for its instruction set, the linker keeps one copy of each for the whole program
+# so an avx512 copy could end up called from the generic kernel, on a CPU without AVX-512
+#
+# cmake -DMODE=localize -DNM=... -DOBJCOPY=... -DINPUT=kernel.o -DOUTPUT=kernel_avx512.o -DSUFFIX=avx512 -P kernel_symbols.cmake
+#	renames the weak symbols of the object to <symbol>.<suffix>, so their COMDAT groups only merge within the instruction set
+# cmake -DMODE=check -DNM=... -DISAS=generic;avx2;avx512 -DOBJECTS_<isa>=... -P kernel_symbols.cmake
+#	fails if a weak symbol is defined by the objects of two instruction sets
+
+# the weak (W, V) and unique (u) symbols an object defines
+function(weak_symbols object out)
+	execute_process(COMMAND ${NM} --defined-only ${object} OUTPUT_VARIABLE listing RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${NM} failed on ${object}")
+	endif()
+	string(REGEX MATCHALL "[^\n]+" lines "${listing}")
+	set(symbols)
+	foreach(line ${lines})
+		if (line MATCHES "^[0-9a-fA-F]* *[WVu] (.+)$")
+			list(APPEND symbols "${CMAKE_MATCH_1}")
+		endif()
+	endforeach()
+	set(${out} ${symbols} PARENT_SCOPE)
+endfunction()
+
+if (MODE STREQUAL "localize")
+	weak_symbols(${INPUT} symbols)
+	set(map "")
+	foreach(symbol ${symbols})
+		string(APPEND map "${symbol} ${symbol}.${SUFFIX}\n")
+	endforeach()
+	file(WRITE ${OUTPUT}.syms "${map}")
+	execute_process(COMMAND ${OBJCOPY} --redefine-syms=${OUTPUT}.syms ${INPUT} ${OUTPUT} RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${OBJCOPY} failed on ${INPUT}")
+	endif()
+elseif (MODE STREQUAL "check")
+	# "symbol isa" sorted, a symbol next to itself with another instruction set is shared
+	set(entries)
+	foreach(isa ${ISAS})
+		set(symbols)
+		foreach(object ${OBJECTS_${isa}})
+			weak_symbols(${object} object_symbols)
+			list(APPEND symbols ${object_symbols})
+		endforeach()
+		list(REMOVE_DUPLICATES symbols)
+		foreach(symbol ${symbols})
+			list(APPEND entries "${symbol} ${isa}")
+		endforeach()
+	endforeach()
+	list(SORT entries)
+
+	set(shared)
+	set(previous_symbol "")
+	foreach(entry ${entries})
+		string(REGEX REPLACE " [^ ]+$" "" symbol "${entry}")
+		if (symbol STREQUAL previous_symbol)
+			list(APPEND shared "${symbol}")
+		endif()
+		set(previous_symbol "${symbol}")
+	endforeach()
+	if (shared)
+		list(REMOVE_DUPLICATES shared)
+		string(REPLACE ";" "\n\t" shared "${shared}")
+		message(FATAL_ERROR "weak symbols shared between instruction sets:\n\t${shared}")
+	endif()
+	list(LENGTH entries count)
+	message(STATUS "${count} weak symbols, none shared between instruction sets")
+else()
+	message(FATAL_ERROR "MODE is localize or check")
+endif()
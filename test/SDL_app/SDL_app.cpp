@@ -4,26 +4,47 @@
 // SCR_W8
 // SCR_H8
 // DUMP_FPS
-// APP_??? (see sandbox.h)
-#include "../shader/sandbox.h"
-
- vec3 sandbox::iResolution	= vec3(SCR_W8, SCR_H8, 0); // viewport resolution (in pixels)
-float sandbox::iTime		= 0; // shader playback time (in seconds)
-float sandbox::iTimeDelta	= 0; // render time (in seconds)
- vec4 sandbox::iMouse;			 // mouse pixel coords. xy: current (if MLB down), zw: click
- vec4 sandbox::iDate;			 // (year, month, day, time in seconds)
+// usage: SDL_app [shader] - one of the registry (see ../shader/shaders.h), VML_SHADER does the same
+// the VML_THREADS environment variable sets the worker count (default all the cores)
+// the VML_TARGET_MS environment variable turns on dynamic resolution with that shading budget per frame
+// the VML_INTERLEAVE environment variable (checkerboard, 2x2) shades only part of the pixels every frame
+// the VML_ADAPTIVE environment variable (a color variance, 0 for the default) shades at full rate only where the image varies
+// the VML_SSAA environment variable (rgss, rooks, stratified) supersamples,
+// VML_SSAA_EDGES (a color delta) only where neighbouring pixels differ by more than that
+// the VML_CHANNEL0..3 environment variables (a PPM, PFM, TGA or QOI file) are iChannel0..3 of every pass,
+// noise[:size] binds a tileable noise volume instead (see ../shader/noise_volume.h)
+// a multipass shader (see ../shader/multipass.h), one with a cubemap pass or a textured one runs its passes every frame
+// and ignores those
+// without any of those unchanged frames aren't shaded again (see ../shader/frame_cache.h)
+// and a still picture waits for input instead of spinning
+// the VML_HOT_RELOAD environment variable (a shader header) rebuilds and swaps in that shader whenever it is saved
+// the VML_PIPELINE environment variable (2, 3) shades that many frames ahead on a thread of their own
+// while this one presents (see ../shader/pipeline.h)
+// the shader itself lives in ../shader/kernel.cpp, this only presents what ../shader/render.h draws
+#include "../shader/render.h"
+#include "../shader/dynamic_resolution.h"
+#include "../shader/interleaved.h"
+#include "../shader/adaptive.h"
+#include "../shader/supersampling.h"
+#include "../shader/frame_cache.h"
+#include "../shader/pipeline.h"
+#include "../shader/hot_reload.h"
+#include "../shader/multipass.h"
+#include "../shader/texture_file.h"
+#include "../shader/noise_volume.h"
 
 #include <SDL.h>
 #undef main
 
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include <thread>
-#include <vector>
+#include <string>
 #include <chrono>
 #include <algorithm>
-#include <execution>
+#include <cmath>
 
  class SDL_app
  {
@@ -32,6 +53,9 @@ float sandbox::iTimeDelta	= 0; // render time (in seconds)
 	 ~SDL_app();
 	 void run();
 	 void draw();
+	 void present();	// VML_PIPELINE's draw()
+	 void run_pipelined();
+	 bool input(const SDL_Event &event); // false to quit
 
  private:
 	 bool IsAlive = false;
@@ -39,12 +63,35 @@ float sandbox::iTimeDelta	= 0; // render time (in seconds)
 	 SDL_Surface* Screen = nullptr;
 	 std::shared_ptr<SDL_Surface> OffScreen;
 
-	 struct WorkDef
-	 {
-		 int height_start;
-		 int height_end;
-	 };
-	 std::vector<WorkDef> WorkerDefs;
+	 vml::render::uniforms Uniforms = {};
+	 const kernel::entry_points *Shader = &kernel::select(); // the hot reloaded one once there is one
+	 // unpinned when pipelined, this thread presents next to the workers
+	 vml::render::tile_scheduler Scheduler { getenv("VML_THREADS") ? atoi(getenv("VML_THREADS")) : 0, 32, 8, !getenv("VML_PIPELINE") };
+
+	 // dynamic resolution, shades into LowRes then upscales to OffScreen
+	 std::unique_ptr<vml::render::resolution_controller> Dynamic;
+	 std::unique_ptr<vml::render::image> LowRes;
+
+	 std::unique_ptr<vml::render::interleaved_renderer> Interleaved;
+	 std::unique_ptr<vml::render::adaptive_renderer> Adaptive;
+	 std::unique_ptr<vml::render::supersampler> Supersampler;
+	 std::unique_ptr<vml::render::multipass_renderer> Multipass; // only for multipass or textured shaders
+
+	 vml::render::texture_loader Loader;
+	 std::shared_ptr<vml::render::texture_file> Textures[kernel::max_channels];
+	 std::unique_ptr<vml::render::noise_volume> Volumes[kernel::max_channels];
+
+	 vml::render::frame_cache Cache { *Shader };
+	 bool Idle = false;	// the last draw() had nothing to shade
+
+	 std::unique_ptr<vml::render::shader_reloader> Reloader;
+
+	 // created last, its thread calls shade() as soon as it exists
+	 std::unique_ptr<vml::render::frame_pipeline> Pipeline;
+
+	 bool shade(const vml::render::framebuffer &out, const vml::render::uniforms &u); // false if nothing needed shading
+	 vml::render::multipass_renderer* make_multipass(); // for Shader, nullptr if it needs none
+	 std::string shaded() const;
 
 	 void log();
  };
@@ -52,6 +99,21 @@ float sandbox::iTimeDelta	= 0; // render time (in seconds)
 
 SDL_app::SDL_app()
 {
+	// decoded while the window opens, the noise volumes are baked (or read back) before it
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		const std::string name = "VML_CHANNEL" + std::to_string(channel);
+		vml::render::noise_options noise;
+		if (const char *path = getenv(name.c_str())) {
+			if (!vml::render::parse_noise(path, noise)) {
+				Textures[channel] = Loader.load(path);
+			} else if (noise.size > 0) {
+				Volumes[channel].reset(new vml::render::noise_volume(noise, Scheduler));
+				printf("noise: %d^3 %s in %.0fms\n", noise.size, Volumes[channel]->cached() ? "read" : "baked",
+					Volumes[channel]->bake_time());
+			}
+		}
+	}
+
 	IsAlive = SDL_Init(SDL_INIT_VIDEO) == 0;
 	if (!IsAlive) {
 		log();
@@ -78,10 +140,47 @@ SDL_app::SDL_app()
 		log();
 		return;
 	}
+
+	if (const char *target_ms = getenv("VML_TARGET_MS")) {
+		Dynamic.reset(new vml::render::resolution_controller(static_cast<float>(atof(target_ms))));
+		LowRes.reset(new vml::render::image(SCR_W8, SCR_H8, vml::render::format::rgb8));
+	}
+
+	if (const char *interleave = getenv("VML_INTERLEAVE")) {
+		using pattern = vml::render::interleaved_renderer::pattern;
+		Interleaved.reset(new vml::render::interleaved_renderer(*Shader,
+			strcmp(interleave, "2x2") == 0 ? pattern::interleave_2x2 : pattern::checkerboard));
+	} else if (const char *adaptive = getenv("VML_ADAPTIVE")) {
+		Adaptive.reset(new vml::render::adaptive_renderer(*Shader));
+		if (atof(adaptive) > 0) {
+			Adaptive->threshold(static_cast<float>(atof(adaptive)));
+		}
+	} else if (const char *ssaa = getenv("VML_SSAA")) {
+		const char *edges = getenv("VML_SSAA_EDGES");
+		Supersampler.reset(new vml::render::supersampler(*Shader, vml::render::supersampler::named(ssaa),
+			edges ? static_cast<float>(atof(edges)) : 0.f));
+	}
+
+	Multipass.reset(make_multipass());
+
+	if (const char *header = getenv("VML_HOT_RELOAD")) {
+		Reloader.reset(new vml::render::shader_reloader(header));
+		if (!Reloader->start()) {
+			printf("can't watch %s\n", header);
+			Reloader.reset();
+		}
+	}
+
+	if (const char *depth = getenv("VML_PIPELINE")) {
+		Pipeline.reset(new vml::render::frame_pipeline(SCR_W8, SCR_H8, vml::render::format::rgb8, atoi(depth),
+			[this](const vml::render::framebuffer &fb, const vml::render::uniforms &u) { shade(fb, u); }));
+	}
 }
 
 SDL_app::~SDL_app()
 {
+	Pipeline.reset(); // before anything it shades with goes
+	Reloader.reset();
 	SDL_Quit();
 }
 
@@ -94,6 +193,51 @@ void SDL_app::log()
 	}
 }
 
+// iMouse like Shadertoy: xy where the button is held down, zw where it was clicked, negative once released
+bool SDL_app::input(const SDL_Event &event)
+{
+	auto &mouse = Uniforms.mouse;
+	switch (event.type) {
+	case SDL_QUIT:
+		return false;
+	case SDL_KEYDOWN:
+		return event.key.keysym.sym != SDLK_ESCAPE;
+	case SDL_MOUSEBUTTONDOWN:
+		if (event.button.button == SDL_BUTTON_LEFT) {
+			mouse[0] = mouse[2] = static_cast<float>(event.button.x);
+			mouse[1] = mouse[3] = static_cast<float>(SCR_H8 - 1 - event.button.y);
+		}
+		break;
+	case SDL_MOUSEBUTTONUP:
+		if (event.button.button == SDL_BUTTON_LEFT) {
+			mouse[2] = -std::abs(mouse[2]);
+			mouse[3] = -std::abs(mouse[3]);
+		}
+		break;
+	case SDL_MOUSEMOTION:
+		if (event.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT)) {
+			mouse[0] = static_cast<float>(event.motion.x);
+			mouse[1] = static_cast<float>(SCR_H8 - 1 - event.motion.y);
+		}
+		break;
+	}
+	return true;
+}
+
+// of the last frame, in the unit of the renderer: adaptive shading and supersampling count main() calls per pixel
+// (4 rgss samples are 4.00 spp), interleaving the share of the quads and the frame cache of the pixels
+std::string SDL_app::shaded() const
+{
+	char text[32];
+	if (Adaptive || Supersampler) {
+		snprintf(text, sizeof(text), "%.2f spp", Adaptive ? Adaptive->shaded() : Supersampler->shaded());
+	} else {
+		snprintf(text, sizeof(text), "%3.0f%% of the %s", 100 * (Interleaved ? Interleaved->shaded() : Cache.shaded()),
+			Interleaved ? "quads" : "pixels");
+	}
+	return text;
+}
+
 void SDL_app::run()
 {
 	assert(IsAlive);
@@ -101,17 +245,20 @@ void SDL_app::run()
 		return;
 	}
 
-	const int count = std::thread::hardware_concurrency();
-	const int slice = SCR_H8 / count;
-	for (int i = 0; i < count; i++) {
-		WorkerDefs.push_back(WorkDef{i * slice, i * slice + slice});
+	printf("shader: %s, isa: %s, threads: %d\n", Shader->shader, Shader->isa, Scheduler.threads());
+	if (Dynamic) {
+		printf("dynamic resolution: %.1fms\n", Dynamic->target());
+	}
+	if (Pipeline) {
+		run_pipelined();
+		return;
 	}
 
 	auto event = SDL_Event();
 	auto running = true;
 	auto time_start = std::chrono::system_clock::now();
 
-	constexpr auto fmt = "curr: %3.2f; max: %3.2f; avrg: %3.2f;\r";
+	constexpr auto fmt = "curr: %3.2f; max: %3.2f; avrg: %3.2f; dispatch: %3.0fus; scale: %.2f; shaded: %s;\r";
 	auto avrg_fps = 0.f;
 	auto max_fps = 0.f;
 	auto frame_num = 1;
@@ -123,63 +270,167 @@ void SDL_app::run()
 	while (running) {
 		auto time_frame = std::chrono::system_clock::now();
 
+		// nothing changes on screen until some input comes, or a new build of the shader
+		if (Idle && Reloader) {
+			SDL_Delay(10);
+		} else if (Idle && SDL_WaitEvent(&event)) {
+			running &= input(event);
+		}
 		while (SDL_PollEvent(&event)) {
-			if (event.type == SDL_QUIT) {
-				running = false;
-			}
-			if (event.type == SDL_KEYDOWN) {
-				if (event.key.keysym.sym == SDLK_ESCAPE) {
-					running = false;
-				}
-			}
+			running &= input(event);
 		}
-		
+
 		draw();
 		SDL_Flip(Screen);
 
 		auto time_now = std::chrono::system_clock::now();
 		std::chrono::duration<float> elapsed_seconds = time_now - time_start;
 		std::chrono::duration<float> frame_seconds = time_now - time_frame;
-		sandbox::iTime = elapsed_seconds.count();
-		sandbox::iTimeDelta = frame_seconds.count();
+		Uniforms.time = elapsed_seconds.count();
+		Uniforms.time_delta = frame_seconds.count();
+		Uniforms.frame++;
 
-		auto curr_fps = 1.f / sandbox::iTimeDelta;
+		auto curr_fps = 1.f / Uniforms.time_delta;
 		max_fps = std::max(max_fps, curr_fps);
 		avrg_fps += (curr_fps - avrg_fps) / frame_num++; // https://en.wikipedia.org/wiki/Moving_average
-		printf(fmt, curr_fps, max_fps, avrg_fps);
+		printf(fmt, curr_fps, max_fps, avrg_fps, Scheduler.dispatch().overhead, Dynamic && !Multipass ? Dynamic->scale() : 1.f,
+			shaded().c_str());
 	}
 
 #ifdef DUMP_FPS
-	fprintf(file.get(), fmt, 0.f, max_fps, avrg_fps);
+	fprintf(file.get(), fmt, 0.f, max_fps, avrg_fps, 0.f, Dynamic && !Multipass ? Dynamic->scale() : 1.f, shaded().c_str());
 #endif
 }
 
+// the shading thread has its own clock, the stats of a frame are only known once it is presented
+void SDL_app::run_pipelined()
+{
+	auto event = SDL_Event();
+	auto running = true;
+
+	while (running) {
+		while (SDL_PollEvent(&event)) {
+			running &= input(event);
+		}
+
+		present();
+
+		const auto &stats = Pipeline->stats();
+		printf("fps: %3.2f; latency: %3.2fms; shading: %3.2fms;\r", stats.throughput, stats.latency, stats.shading);
+	}
+}
+
+void SDL_app::present()
+{
+	Pipeline->update(Uniforms);
+	const auto frame = Pipeline->acquire();
+
+	const auto bmp = OffScreen.get();
+	const int row = frame->width * vml::render::bytes_per_pixel(frame->fmt);
+	for (int y = 0; y < frame->height; ++y) {
+		memcpy(static_cast<uint8_t*>(bmp->pixels) + y * bmp->pitch, static_cast<const uint8_t*>(frame->pixels) + y * frame->pitch, row);
+	}
+	SDL_BlitSurface(OffScreen.get(), NULL, Screen, NULL);
+	SDL_Flip(Screen);
+
+	Pipeline->release();
+}
+
 void SDL_app::draw()
 {
-	std::for_each(std::execution::par, WorkerDefs.begin(), WorkerDefs.end(),
-		[bmp = OffScreen.get()](const WorkDef work)
-		{
-			sandbox::fragment_shader shader;
-			for (int y = work.height_start; y < work.height_end; ++y) {
-				uint8_t* ptr = reinterpret_cast<uint8_t*>(bmp->pixels) + y * bmp->pitch;
-				for (int x = 0; x < bmp->w; ++x) {
-					shader.gl_FragCoord = vec2(static_cast<float>(x), bmp->h - 1.0f - y);
-					shader.main(shader.gl_FragColor, shader.gl_FragCoord);
-					const auto color = sandbox::clamp(shader.gl_FragColor, 0.0f, 1.0f);
-
-					*ptr++ = static_cast<uint8_t>(255 * color.r + 0.5f);
-					*ptr++ = static_cast<uint8_t>(255 * color.g + 0.5f);
-					*ptr++ = static_cast<uint8_t>(255 * color.b + 0.5f);
-				}
+	const auto bmp = OffScreen.get();
+	const vml::render::framebuffer out = { bmp->pixels, bmp->w, bmp->h, bmp->pitch, vml::render::format::rgb8 };
+
+	Idle = !shade(out, Uniforms);
+	SDL_BlitSurface(OffScreen.get(), NULL, Screen, NULL);
+}
+
+vml::render::multipass_renderer* SDL_app::make_multipass()
+{
+	bool textured = false;
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		textured = textured || Textures[channel] || Volumes[channel];
+	}
+	if (Shader->traits->buffers == 0 && !Shader->traits->cubemap && !textured) {
+		return nullptr;
+	}
+
+	auto multipass = new vml::render::multipass_renderer(*Shader);
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		if (Volumes[channel]) {
+			for (int pass = 0; pass < vml::render::multipass_renderer::passes; ++pass) {
+				multipass->bind(static_cast<kernel::shader_pass>(pass), channel, Volumes[channel]->channel());
 			}
 		}
-	);
+		if (!Textures[channel]) {
+			continue;
+		}
+		if (!Textures[channel]->ok()) {
+			printf("%s\n", Textures[channel]->error());
+			continue;
+		}
+		for (int pass = 0; pass < vml::render::multipass_renderer::passes; ++pass) {
+			multipass->bind(static_cast<kernel::shader_pass>(pass), channel, Textures[channel]->channel());
+		}
+	}
+	return multipass;
+}
 
-	SDL_BlitSurface(OffScreen.get(), NULL, Screen, NULL);
+// from the thread that renders, between frames
+bool SDL_app::shade(const vml::render::framebuffer &out, const vml::render::uniforms &u)
+{
+	if (Reloader && Reloader->poll()) {
+		printf("\nreloaded in %.0fms (build %.0fms)\n", Reloader->latency(), Reloader->build_time());
+		Shader = Reloader->shader();
+		Cache.shader(*Shader);
+		if (Interleaved) {
+			Interleaved->shader(*Shader);
+		}
+		if (Adaptive) {
+			Adaptive->shader(*Shader);
+		}
+		if (Supersampler) {
+			Supersampler->shader(*Shader);
+		}
+		Multipass.reset(make_multipass());
+	}
+
+	// the buffers of a multipass shader are the size of what it renders to, a change of scale would start them over
+	const bool scaled = Dynamic && !Multipass;
+	const auto target = scaled ? Dynamic->view(LowRes->view()) : out;
+	const auto start = std::chrono::steady_clock::now();
+	bool shaded = true;
+	if (Multipass) {
+		Multipass->render(target, u, Scheduler);
+	} else if (Interleaved) {
+		Interleaved->render(target, u, Scheduler);
+	} else if (Adaptive) {
+		Adaptive->render(target, u, Scheduler);
+	} else if (Supersampler) {
+		Supersampler->render(target, u, Scheduler);
+	} else {
+		shaded = Cache.render(target, u, Scheduler);
+	}
+	const std::chrono::duration<float, std::milli> shading = std::chrono::steady_clock::now() - start;
+
+	if (scaled && shaded) {
+		Dynamic->update(shading.count());
+		vml::render::upscale(target, out, Scheduler);
+	}
+	return shaded;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	if (argc > 1 && !kernel::use(argv[1])) {
+		printf("no shader named %s, there is:", argv[1]);
+		for (int i = 0; kernel::shader_name(i); ++i) {
+			printf(" %s", kernel::shader_name(i));
+		}
+		printf("\n");
+		return 1;
+	}
+
 	SDL_app app;
 	app.run();
 
@@ -0,0 +1,282 @@
+// Renders one frame of the sandboxed shader to a file, no display needed, or a video of some of them
+// usage: render_cli [options] out.ppm|out.pfm|out.y4m|out.rgb|-
+//   -w <width>      (default 640)
+//   -h <height>     (default 360)
+//   -t <seconds>    iTime (default 0)
+//   -f <frame>      iFrame (default 0), the buffers of a multipass shader run every frame up to it at 60 fps
+//                   (its cubemap pass is baked once before the first one)
+//   -m <x,y,z,w>    iMouse (default 0,0,0,0)
+//   -j <threads>    (default all the cores)
+//   -S <shader>     one of the registry (see shader/shaders.h), list prints them
+//   -a <variance>   adaptive shading, full rate only where the colors vary more than that (0 for the default)
+//   -s <pattern>    supersampling: rgss, rooks or stratified
+//   -e <delta>      supersample only the pixels differing from a neighbour by more than that
+//   -c <n>=<file>   a PPM, PFM, TGA or QOI file as iChannel<n> of every pass
+//                   or noise[:size], a tileable noise volume baked for it (see shader/noise_volume.h)
+//   -v <first>:<last>  a video of those frames at a fixed iTimeDelta (see shader/video.h), -t and -f are ignored
+//   -r <fps>        of the video, a number or a ratio like 30000/1001 (default 60)
+//   -d <frames>     of the video in flight at a time (default one per thread)
+// .pfm keeps the shader output in float, anything else is written as 8-bit PPM
+// a video is written as Y4M to .y4m or - (stdout, the rest of the output goes to stderr then), as raw rgb24 to anything else
+
+#include "shader/render.h"
+#include "shader/adaptive.h"
+#include "shader/supersampling.h"
+#include "shader/multipass.h"
+#include "shader/texture_file.h"
+#include "shader/noise_volume.h"
+#include "shader/video.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+int usage()
+{
+	printf("usage: render_cli [-w width] [-h height] [-t time] [-f frame] [-m x,y,z,w] [-j threads] [-S shader|list] [-a variance] [-s pattern] [-e delta] [-c n=file|noise[:size]] [-v first:last] [-r fps] [-d frames] out.ppm|out.pfm|out.y4m|out.rgb|-\n");
+	return 1;
+}
+
+bool ends_with(const char *str, const char *suffix)
+{
+	const auto len = strlen(str), suffix_len = strlen(suffix);
+	return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+	int width = 640;
+	int height = 360;
+	int threads = 0;
+	float adaptive = -1;
+	const kernel::entry_points *entry = &kernel::select();
+	auto samples = vml::render::supersampler::pattern::none;
+	float edges = 0;
+	const char *path = nullptr;
+	const char *textures[kernel::max_channels] = {};
+	vml::render::uniforms u = {};
+	vml::render::video_options video;
+	bool is_video = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (strcmp(arg, "-w") == 0 && has_value) {
+			width = atoi(argv[++i]);
+		} else if (strcmp(arg, "-h") == 0 && has_value) {
+			height = atoi(argv[++i]);
+		} else if (strcmp(arg, "-t") == 0 && has_value) {
+			u.time = static_cast<float>(atof(argv[++i]));
+		} else if (strcmp(arg, "-f") == 0 && has_value) {
+			u.frame = atoi(argv[++i]);
+		} else if (strcmp(arg, "-m") == 0 && has_value) {
+			if (sscanf(argv[++i], "%f,%f,%f,%f", &u.mouse[0], &u.mouse[1], &u.mouse[2], &u.mouse[3]) != 4) {
+				return usage();
+			}
+		} else if (strcmp(arg, "-j") == 0 && has_value) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(arg, "-S") == 0 && has_value) {
+			const char *shader = argv[++i];
+			if (strcmp(shader, "list") == 0) {
+				for (int n = 0; kernel::shader_name(n); ++n) {
+					printf("%s\n", kernel::shader_name(n));
+				}
+				return 0;
+			}
+			entry = kernel::find(shader);
+			if (!entry) {
+				printf("no shader named %s\n", shader);
+				return 1;
+			}
+		} else if (strcmp(arg, "-a") == 0 && has_value) {
+			adaptive = static_cast<float>(atof(argv[++i]));
+		} else if (strcmp(arg, "-s") == 0 && has_value) {
+			samples = vml::render::supersampler::named(argv[++i]);
+			if (samples == vml::render::supersampler::pattern::none) {
+				return usage();
+			}
+		} else if (strcmp(arg, "-e") == 0 && has_value) {
+			edges = static_cast<float>(atof(argv[++i]));
+		} else if (strcmp(arg, "-c") == 0 && has_value) {
+			const char *binding = argv[++i];
+			const int channel = binding[0] - '0';
+			if (channel < 0 || channel >= kernel::max_channels || binding[1] != '=') {
+				return usage();
+			}
+			textures[channel] = binding + 2;
+		} else if (strcmp(arg, "-v") == 0 && has_value) {
+			if (sscanf(argv[++i], "%d:%d", &video.first, &video.last) != 2 || video.first < 0 || video.last < video.first) {
+				return usage();
+			}
+			is_video = true;
+		} else if (strcmp(arg, "-r") == 0 && has_value) {
+			const int fields = sscanf(argv[++i], "%d/%d", &video.fps_num, &video.fps_den);
+			if (fields < 1 || video.fps_num <= 0 || (fields == 2 && video.fps_den <= 0)) {
+				return usage();
+			}
+		} else if (strcmp(arg, "-d") == 0 && has_value) {
+			video.depth = atoi(argv[++i]);
+		} else if ((arg[0] != '-' || strcmp(arg, "-") == 0) && !path) {
+			path = arg;
+		} else {
+			return usage();
+		}
+	}
+	if (!path || width <= 0 || height <= 0) {
+		return usage();
+	}
+	const bool to_stdout = strcmp(path, "-") == 0;
+	if (to_stdout && !is_video) {
+		return usage();
+	}
+	FILE *info = to_stdout ? stderr : stdout;
+
+	// decoded while the rest is set up
+	vml::render::texture_loader loader;
+	std::shared_ptr<vml::render::texture_file> files[kernel::max_channels];
+	vml::render::noise_options noise[kernel::max_channels];
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		if (textures[channel] && vml::render::parse_noise(textures[channel], noise[channel])) {
+			if (noise[channel].size <= 0) {
+				return usage();
+			}
+		} else if (textures[channel]) {
+			files[channel] = loader.load(textures[channel]);
+		}
+	}
+
+	const bool pfm = ends_with(path, ".pfm");
+	vml::render::image img(width, height, pfm ? vml::render::format::rgba32f : vml::render::format::rgb8);
+
+	vml::render::tile_scheduler scheduler(threads);
+	vml::render::adaptive_renderer adaptive_renderer(*entry);
+	if (adaptive > 0) {
+		adaptive_renderer.threshold(adaptive);
+	}
+	vml::render::supersampler supersampler(*entry, samples, edges);
+
+	vml::render::multipass_renderer multipass(*entry);
+	bool textured = false;
+	std::unique_ptr<vml::render::noise_volume> volumes[kernel::max_channels];
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		if (textures[channel] && !files[channel]) {
+			volumes[channel].reset(new vml::render::noise_volume(noise[channel], scheduler));
+			const auto &volume = *volumes[channel];
+			fprintf(info, "noise: %d^3 %s in %.2fms%s%s\n", volume.size(), volume.cached() ? "read" : "baked", volume.bake_time(),
+				volume.path().empty() ? "" : ", cache: ", volume.path().c_str());
+			for (int pass = 0; pass < vml::render::multipass_renderer::passes; ++pass) {
+				multipass.bind(static_cast<kernel::shader_pass>(pass), channel, volume.channel());
+			}
+			textured = true;
+			continue;
+		}
+		if (!files[channel]) {
+			continue;
+		}
+		if (!files[channel]->ok()) {
+			fprintf(info, "%s\n", files[channel]->error());
+			return 1;
+		}
+		fprintf(info, "%s: %dx%d%s, ready in %.2fms (decode: %.2fms)\n", files[channel]->path().c_str(), files[channel]->width(),
+			files[channel]->height(), files[channel]->in_place() ? " in place" : "", files[channel]->latency(),
+			files[channel]->decode_time());
+		for (int pass = 0; pass < vml::render::multipass_renderer::passes; ++pass) {
+			multipass.bind(static_cast<kernel::shader_pass>(pass), channel, files[channel]->channel());
+		}
+		textured = true;
+	}
+
+	if (is_video) {
+		// a shader without buffers has its frames in flight, the image pass alone once the cubemap is baked
+		vml::render::video_renderer::shade_func shade = [entry](const vml::render::framebuffer &fb,
+			const vml::render::uniforms &frame, vml::render::tile_scheduler &frame_scheduler)
+		{
+			vml::render::shade(*entry, fb, frame, frame_scheduler);
+		};
+		video.sequential = multipass.buffers() > 0;
+		if (video.sequential) {
+			shade = [&multipass](const vml::render::framebuffer &fb, const vml::render::uniforms &frame,
+				vml::render::tile_scheduler &frame_scheduler)
+			{
+				multipass.render(fb, frame, frame_scheduler);
+			};
+		} else if (multipass.cubemap() || textured) {
+			multipass.bake(u, scheduler);
+			shade = [&multipass](const vml::render::framebuffer &fb, const vml::render::uniforms &frame,
+				vml::render::tile_scheduler &frame_scheduler)
+			{
+				multipass.render_image(fb, frame, frame_scheduler);
+			};
+		}
+		video.threads = threads;
+		video.format = to_stdout || ends_with(path, ".y4m") ? vml::render::video_format::y4m : vml::render::video_format::rgb24;
+
+		FILE *out = to_stdout ? stdout : fopen(path, "wb");
+		if (!out) {
+			fprintf(info, "can't write %s\n", path);
+			return 1;
+		}
+		vml::render::video_renderer renderer(width, height, video, shade);
+		const bool ok = renderer.render(out, u);
+		if (!to_stdout) {
+			fclose(out);
+		}
+		if (!ok) {
+			fprintf(info, "can't write %s\n", path);
+			return 1;
+		}
+
+		const auto &stats = renderer.stats();
+		fprintf(info, "%s: %s %dx%d, %d frames in %.2fms, %.1f fps (isa: %s, %s, %.2fms a frame, %d reordered at most)\n",
+			path, entry->shader, width, height, stats.frames, stats.elapsed, 1000 * stats.frames / stats.elapsed,
+			entry->isa, video.sequential ? "in order" : "in flight", stats.shading, stats.reordered);
+		if (const auto cube = multipass.cubemap()) {
+			fprintf(info, "cubemap: 6 faces of %dx%d baked in %.2fms\n", cube->size(), cube->size(), cube->bake_time());
+		}
+		return 0;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	if (multipass.buffers() > 0 || multipass.cubemap() || textured) {
+		// the frames before this one shade into the same image, only the last one is kept
+		const float frame_time = 1 / 60.f;
+		vml::render::uniforms frame = u;
+		frame.time_delta = frame_time;
+		for (frame.frame = 0; frame.frame <= u.frame; ++frame.frame) {
+			frame.time = u.time - (u.frame - frame.frame) * frame_time;
+			multipass.render(img.view(), frame, scheduler);
+		}
+	} else if (adaptive >= 0) {
+		adaptive_renderer.render(img.view(), u, scheduler);
+	} else if (samples != vml::render::supersampler::pattern::none) {
+		supersampler.render(img.view(), u, scheduler);
+	} else {
+		vml::render::shade(*entry, img.view(), u, scheduler);
+	}
+	const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (!(pfm ? vml::render::write_pfm(path, img.view()) : vml::render::write_ppm(path, img.view()))) {
+		fprintf(info, "can't write %s\n", path);
+		return 1;
+	}
+	fprintf(info, "%s: %s %dx%d in %.2fms (isa: %s, threads: %d, dispatch: %.0fus)\n", path, entry->shader,
+		width, height, elapsed.count(), entry->isa, scheduler.threads(), scheduler.dispatch().overhead);
+	if (const auto cube = multipass.cubemap()) {
+		fprintf(info, "cubemap: 6 faces of %dx%d baked in %.2fms\n", cube->size(), cube->size(), cube->bake_time());
+	}
+	if (adaptive >= 0) {
+		fprintf(info, "shaded: %.0f%% of the pixels, %.0f%% of the blocks at full rate\n",
+			100 * adaptive_renderer.shaded(), 100 * adaptive_renderer.refined());
+	} else if (samples != vml::render::supersampler::pattern::none) {
+		fprintf(info, "shaded: %.2f samples per pixel, %.0f%% of the pixels supersampled\n",
+			supersampler.shaded(), 100 * supersampler.supersampled());
+	}
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+// How frame shading scales with the thread count, tiles with work stealing vs one slab per thread
+// usage: scaling_bench [-w width] [-h height] [-n frames] [-j max threads] [-t iTime] [-S shader|all]
+// -S all runs every shader of the registry one after the other (see shader/shaders.h)
+// prints the median frame time of every thread count, speedup and efficiency are against 1 thread
+// dispatch is what the thread pool itself cost on the last frame with tiles (see dispatch_stats)
+// run it on the machine you care about, a core count of a few doesn't say much
+
+#include "shader/render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+float median_ms(const kernel::entry_points &shader, const vml::render::framebuffer &fb, const vml::render::uniforms &u,
+	vml::render::tile_scheduler &scheduler, int frames)
+{
+	std::vector<float> times;
+	for (int i = 0; i < frames; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		vml::render::shade(shader, fb, u, scheduler);
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	return times[times.size() / 2];
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+	int width = 640;
+	int height = 360;
+	int frames = 5;
+	int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+	vml::render::uniforms u = {};
+	u.time = 1.f;
+	const char *shader = nullptr;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-w") == 0) {
+			width = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-h") == 0) {
+			height = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-n") == 0) {
+			frames = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-j") == 0) {
+			max_threads = atoi(argv[i + 1]);
+		} else if (strcmp(argv[i], "-t") == 0) {
+			u.time = static_cast<float>(atof(argv[i + 1]));
+		} else if (strcmp(argv[i], "-S") == 0) {
+			shader = argv[i + 1];
+		}
+	}
+	width = std::max(1, width);
+	height = std::max(1, height);
+	frames = std::max(1, frames);
+	max_threads = std::max(1, max_threads);
+
+	std::vector<int> counts;
+	for (int n = 1; n < max_threads; n *= 2) {
+		counts.push_back(n);
+	}
+	counts.push_back(max_threads);
+
+	std::vector<const char*> shaders;
+	if (!shader) {
+		shaders.push_back(kernel::select().shader);
+	} else if (strcmp(shader, "all") == 0) {
+		for (int i = 0; kernel::shader_name(i); ++i) {
+			shaders.push_back(kernel::shader_name(i));
+		}
+	} else {
+		shaders.push_back(shader);
+	}
+
+	vml::render::image img(width, height, vml::render::format::rgb8);
+	const auto fb = img.view();
+	printf("%dx%d, median of %d frames, isa: %s\n", width, height, frames, kernel::select().isa);
+
+	for (const char *name : shaders) {
+		const auto *entry = kernel::find(name);
+		if (!entry) {
+			printf("no shader named %s\n", name);
+			return 1;
+		}
+
+		printf("\n%s\n", name);
+		printf("%7s %10s %10s %8s %8s %10s %7s %12s\n", "threads", "slabs ms", "tiles ms", "speedup", "eff.", "vs slabs", "steals", "dispatch us");
+
+		float single = 0;
+		for (const int n : counts) {
+			vml::render::tile_scheduler slabs(n, width, (height + n - 1) / n);
+			vml::render::tile_scheduler tiles(n);
+
+			const float slabs_ms = median_ms(*entry, fb, u, slabs, frames);
+			const float tiles_ms = median_ms(*entry, fb, u, tiles, frames);
+			single = n == 1 ? tiles_ms : single;
+
+			const float speedup = single / tiles_ms;
+			printf("%7d %10.2f %10.2f %7.2fx %7.0f%% %9.2fx %7d %12.1f\n", n, slabs_ms, tiles_ms,
+				speedup, 100 * speedup / n, slabs_ms / tiles_ms, tiles.steals(), tiles.dispatch().overhead);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include "adaptive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace vml { namespace render {
+
+namespace {
+
+const float* coarse_pixel(const framebuffer &coarse, int x, int y)
+{
+	return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(coarse.pixels) + y * coarse.pitch) + x * 4;
+}
+
+void store(const framebuffer &out, int x, int y, const float rgba[4])
+{
+	auto row = reinterpret_cast<uint8_t*>(out.pixels) + y * out.pitch;
+	if (out.fmt == format::rgba32f) {
+		memcpy(reinterpret_cast<float*>(row) + x * 4, rgba, sizeof(float) * 4);
+		return;
+	}
+
+	const int channels = bytes_per_pixel(out.fmt);
+	for (int c = 0; c < channels; ++c) {
+		row[x * channels + c] = static_cast<uint8_t>(255 * std::clamp(rgba[c], 0.f, 1.f) + .5f);
+	}
+}
+
+} // anonymous namespace
+
+adaptive_renderer::adaptive_renderer(const kernel::entry_points &shader, float threshold, int step)
+	: Shader(&shader), Threshold(threshold), Step(std::max(2, step & ~1))
+{
+}
+
+void adaptive_renderer::render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler)
+{
+	const int step = Step;
+	const int blocks_x = (out.width + step - 1) / step;
+	const int blocks_y = (out.height + step - 1) / step;
+	if (!Coarse || out.width != Width || out.height != Height) {
+		Width = out.width;
+		Height = out.height;
+		Coarse.reset(new image(blocks_x + 1, blocks_y + 1, format::rgba32f));
+	}
+
+	const auto &kernel = *Shader;
+	uniforms full = u;
+	full.resolution[0] = static_cast<float>(out.width);
+	full.resolution[1] = static_cast<float>(out.height);
+	full.resolution[2] = 1.f;
+
+	// coarse samples are where the pixels at the corners of the blocks are, the bottom and right ones can be outside
+	const auto coarse = Coarse->view();
+	scheduler.run(coarse.width, coarse.height, [&](const tile &t)
+	{
+		kernel.shade_rect({ &full, coarse.pixels, coarse.pitch, coarse.fmt, coarse.width, coarse.height,
+			t.x_begin, t.y_begin, t.x_end, t.y_end, kernel::quad_pattern::all, 0, step, out.height });
+	});
+
+	// the tiles are in blocks
+	const float threshold = Threshold;
+	std::atomic<int> refined { 0 }, refined_pixels { 0 };
+	scheduler.run(blocks_x, blocks_y, [&](const tile &t)
+	{
+		int count = 0, pixels = 0;
+		for (int by = t.y_begin; by < t.y_end; ++by) {
+			const int y_begin = by * step;
+			const int y_end = std::min(y_begin + step, out.height);
+
+			// flagged blocks next to each other are shaded together
+			int run = -1;
+			auto flush = [&](int bx_end)
+			{
+				if (run >= 0) {
+					kernel.shade_rect({ &full, out.pixels, out.pitch, out.fmt, out.width, out.height,
+						run * step, y_begin, std::min(bx_end * step, out.width), y_end,
+						kernel::quad_pattern::all, 0, 1, out.height });
+					run = -1;
+				}
+			};
+
+			for (int bx = t.x_begin; bx < t.x_end; ++bx) {
+				const int x_begin = bx * step;
+				const int x_end = std::min(x_begin + step, out.width);
+
+				float sum[3] = {}, squares[3] = {};
+				int samples = 0;
+				for (int sy = std::max(by - 1, 0); sy <= std::min(by + 2, coarse.height - 1); ++sy) {
+					for (int sx = std::max(bx - 1, 0); sx <= std::min(bx + 2, coarse.width - 1); ++sx, ++samples) {
+						const auto p = coarse_pixel(coarse, sx, sy);
+						for (int c = 0; c < 3; ++c) {
+							sum[c] += p[c];
+							squares[c] += p[c] * p[c];
+						}
+					}
+				}
+				float variance = 0;
+				for (int c = 0; c < 3; ++c) {
+					const float mean = sum[c] / samples;
+					variance = std::max(variance, squares[c] / samples - mean * mean);
+				}
+
+				if (!(variance <= threshold)) { // NaNs get refined too
+					++count;
+					pixels += (x_end - x_begin) * (y_end - y_begin);
+					run = run < 0 ? bx : run;
+					continue;
+				}
+				flush(bx);
+
+				const float *corners[4] = {
+					coarse_pixel(coarse, bx, by), coarse_pixel(coarse, bx + 1, by),
+					coarse_pixel(coarse, bx, by + 1), coarse_pixel(coarse, bx + 1, by + 1)
+				};
+				for (int y = y_begin; y < y_end; ++y) {
+					const float fy = static_cast<float>(y - y_begin) / step;
+					for (int x = x_begin; x < x_end; ++x) {
+						const float fx = static_cast<float>(x - x_begin) / step;
+						float rgba[4];
+						for (int c = 0; c < 4; ++c) {
+							const float top = corners[0][c] + (corners[1][c] - corners[0][c]) * fx;
+							const float bottom = corners[2][c] + (corners[3][c] - corners[2][c]) * fx;
+							rgba[c] = top + (bottom - top) * fy;
+						}
+						store(out, x, y, rgba);
+					}
+				}
+			}
+			flush(t.x_end);
+		}
+		refined += count;
+		refined_pixels += pixels;
+	});
+
+	const float pixels = static_cast<float>(out.width) * out.height;
+	Refined = refined / (static_cast<float>(blocks_x) * blocks_y);
+	Shaded = (static_cast<float>(coarse.width) * coarse.height + refined_pixels) / pixels;
+}
+
+} } // namespace vml::render
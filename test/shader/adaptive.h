@@ -0,0 +1,57 @@
+#pragma once
+
+// Content-adaptive shading: main() runs on a coarse grid (every step-th pixel) first,
+// the blocks between the coarse samples whose colors vary more than a threshold are then shaded
+// at full rate and the others are bilinearly interpolated from their corners
+//
+// the variance of a block is taken over its 4 corners and the ring of samples around them
+// so an edge going through a neighbouring block also gets this one refined;
+// features smaller than a block that fall between the samples are lost, lower the threshold
+// or the step for shaders that have those
+//
+// usage:
+//   adaptive_renderer adaptive(kernel::select(), 1.f / 1024);
+//   adaptive.render(out, u, scheduler);
+//   printf("%.0f%%\n", 100 * adaptive.shaded());
+
+#include "render.h"
+
+#include <memory>
+
+namespace vml { namespace render {
+
+class adaptive_renderer
+{
+public:
+	// threshold: color variance (per channel, 0..1 colors) above which a block is shaded at full rate
+	// step: distance between the coarse samples in pixels, even so blocks are made of whole quads
+	explicit adaptive_renderer(const kernel::entry_points &shader, float threshold = 1.f / 1024, int step = 4);
+
+	// what render() shades from now on, it has to stay loaded as long as this uses it
+	void shader(const kernel::entry_points &s) { Shader = &s; }
+
+	float threshold() const { return Threshold; }
+	void threshold(float t) { Threshold = t; }
+
+	void render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler);
+
+	// of the last frame, main() calls (coarse and refined) per pixel of out, the fraction of the pixels shaded
+	float shaded() const { return Shaded; }
+
+	// of the last frame, the fraction of the blocks shaded at full rate
+	float refined() const { return Refined; }
+
+private:
+	const kernel::entry_points *Shader;
+	float Threshold;
+	int Step;
+
+	int Width = 0;
+	int Height = 0;
+	std::unique_ptr<image> Coarse;	// float rgba, one more column and row than blocks for their right and bottom edges
+
+	float Shaded = 0;
+	float Refined = 0;
+};
+
+} } // namespace vml::render
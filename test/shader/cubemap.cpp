@@ -0,0 +1,50 @@
+#include "cubemap.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace vml { namespace render {
+
+baked_cubemap::baked_cubemap(int size, vml::sampler_state sampler)
+	: Storage(size, vml::texel_format::rgba32f, nullptr), Sampler(sampler)
+{
+	for (int i = 0; i < Storage.levels(); ++i) {
+		const auto &level = Storage.level(i);
+		Levels[i] = { level.texels, { level.size[0], level.size[1], level.size[2] }, { level.pitch[0], level.pitch[1] },
+			static_cast<int>(level.layout), level.bits };
+	}
+}
+
+kernel::channel baked_cubemap::channel() const
+{
+	return { Levels, Storage.levels(), static_cast<int>(Sampler.filtering), static_cast<int>(Sampler.wrapping),
+		kernel::channel_type::cubemap };
+}
+
+void baked_cubemap::bake(const kernel::entry_points &shader, uniforms u, tile_scheduler &scheduler,
+	const kernel::channel *channels)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const int n = size();
+	u.resolution[0] = static_cast<float>(n);
+	u.resolution[1] = static_cast<float>(n);
+	u.resolution[2] = 1.f;
+
+	// the faces stacked into one n x 6n frame; a face is shaded as a framebuffer from its top row (t = 1) down
+	const int pitch = static_cast<int>(Storage.level(0).pitch[0]);
+	scheduler.run(n, 6 * n, [this, &u, &shader, channels, n, pitch](const tile &t)
+	{
+		for (int face = t.y_begin / n; face < 6 && face * n < t.y_end; ++face) {
+			const int y_begin = std::max(t.y_begin - face * n, 0);
+			const int y_end = std::min(t.y_end - face * n, n);
+			shader.shade_rect({ &u, Storage.texel(face, 0, n - 1), -pitch, kernel::pixel_format::rgba32f, n, n,
+				t.x_begin, y_begin, t.x_end, y_end, kernel::quad_pattern::all, 0, 1, n, kernel::sample_pattern::none,
+				kernel::shader_pass::cubemap, channels, static_cast<kernel::cube_face>(face) });
+		}
+	});
+	Storage.generate_mipmaps();
+
+	BakeTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} } // namespace vml::render
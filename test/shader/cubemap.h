@@ -0,0 +1,44 @@
+#pragma once
+
+// Shadertoy's Cube A: the mainCubemap of a shader (see SHADER_CUBEMAP in sandbox.h) baked into a cubemap once,
+// so the passes reading it through iChannel0..3 pay for a lookup per pixel instead of the whole sky integral
+// the six faces are one run of the tile scheduler: the tiles of all of them are spread over the cores together,
+// nobody waits at the end of a face; they are shaded straight into the base level, then the mips are made from it
+//
+// usage:
+//   baked_cubemap sky(512);
+//   sky.bake(kernel::select(), u, scheduler);		// once, or whenever what the sky depends on changes
+//   passes.bind(kernel::shader_pass::image, 0, sky.channel());
+
+#include "render.h"
+#include "../../vml/sampler.h"
+
+namespace vml { namespace render {
+
+class baked_cubemap
+{
+public:
+	// size: of a face, in texels; it is always filtered seamlessly whatever the wrap
+	explicit baked_cubemap(int size, vml::sampler_state sampler = { vml::filter::trilinear, vml::wrap::clamp });
+
+	// the cubemap pass of shader, reading channels ([max_channels] or nullptr) as iChannel0..3
+	// u.resolution becomes the size of a face
+	void bake(const kernel::entry_points &shader, uniforms u, tile_scheduler &scheduler,
+		const kernel::channel *channels = nullptr);
+
+	int size() const { return Storage.size(); }
+
+	// stays valid for the lifetime of this, bake() only changes the texels
+	kernel::channel channel() const;
+
+	// ms the last bake() took, mips included
+	float bake_time() const { return BakeTime; }
+
+private:
+	vml::cubemap_storage Storage;
+	vml::sampler_state Sampler;
+	kernel::channel_level Levels[vml::max_texture_levels];
+	float BakeTime = 0;
+};
+
+} } // namespace vml::render
@@ -0,0 +1,55 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vml { namespace render {
+
+namespace {
+
+constexpr float steps = 32;	// scales are multiples of 1/steps so the picture doesn't wobble every frame
+
+int scaled(int size, float scale)
+{
+	const int out = static_cast<int>(size * scale + .5f) & ~1;
+	return std::min(size, std::max(2, out));
+}
+
+} // anonymous namespace
+
+resolution_controller::resolution_controller(float target_ms, float min_scale, float max_scale)
+	: Target(target_ms),
+	MinScale(std::clamp(min_scale, 1.f / steps, 1.f)),
+	MaxScale(std::clamp(max_scale, MinScale, 1.f)),
+	Scale(MaxScale)
+{
+}
+
+framebuffer resolution_controller::view(const framebuffer &fb) const
+{
+	if (Scale >= 1.f) {
+		return fb;
+	}
+	return { fb.pixels, scaled(fb.width, Scale), scaled(fb.height, Scale), fb.pitch, fb.fmt };
+}
+
+void resolution_controller::update(float shading_ms)
+{
+	if (!(shading_ms > 0.f) || !(Target > 0.f)) {
+		return;
+	}
+
+	// cost scales with the pixel count
+	const float cost = shading_ms / (Scale * Scale);
+	FullCost = FullCost == 0.f ? cost : FullCost + (cost - FullCost) * (cost > FullCost ? .5f : .1f);
+
+	float wanted = std::floor(std::sqrt(Target / FullCost) * steps) / steps;
+	wanted = std::clamp(wanted, MinScale, MaxScale);
+
+	// down as soon as needed, up only when it is a visible step (or the last one to the maximum)
+	if (wanted < Scale || wanted - Scale >= 2 / steps || wanted == MaxScale) {
+		Scale = wanted;
+	}
+}
+
+} } // namespace vml::render
@@ -0,0 +1,42 @@
+#pragma once
+
+// Dynamic resolution: picks the shading resolution of the next frame so it fits a frame time budget
+// the cost of a pixel is estimated from the frames so far (going up fast, down slowly so a spike
+// isn't followed by another one) and the scale is the one that would have fit the budget with it
+// the result goes through render::upscale() to the output size
+//
+// usage:
+//   resolution_controller dyn(16.f);
+//   auto low = dyn.view(full);  // full.width * scale x full.height * scale, same pixels and pitch
+//   ... shade into low, time it ...
+//   render::upscale(low, out, scheduler);
+//   dyn.update(shading_ms);
+
+#include "render.h"
+
+namespace vml { namespace render {
+
+class resolution_controller
+{
+public:
+	// scale is relative to the output width and height
+	explicit resolution_controller(float target_ms, float min_scale = .25f, float max_scale = 1.f);
+
+	float scale() const { return Scale; }
+	float target() const { return Target; }
+
+	// the top left part of fb to shade at the current scale, sizes are even so quads stay whole
+	framebuffer view(const framebuffer &fb) const;
+
+	// shading_ms is what the last view() took to shade
+	void update(float shading_ms);
+
+private:
+	float Target;
+	float MinScale;
+	float MaxScale;
+	float Scale;
+	float FullCost = 0;	// estimated ms of a frame at scale 1
+};
+
+} } // namespace vml::render
@@ -0,0 +1,121 @@
+#include "frame_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vml { namespace render {
+
+namespace {
+
+bool same(const framebuffer &a, const framebuffer &b)
+{
+	return a.pixels == b.pixels && a.width == b.width && a.height == b.height && a.pitch == b.pitch && a.fmt == b.fmt;
+}
+
+bool overlap(const tile &a, const tile &b)
+{
+	return a.x_begin < b.x_end && b.x_begin < a.x_end && a.y_begin < b.y_end && b.y_begin < a.y_end;
+}
+
+} // anonymous namespace
+
+frame_cache::frame_cache(const kernel::entry_points &shader)
+	: Shader(&shader), Traits(*shader.traits)
+{
+}
+
+void frame_cache::shader(const kernel::entry_points &s)
+{
+	Shader = &s;
+	Traits = *s.traits;
+	invalidate();
+}
+
+void frame_cache::invalidate(const tile &rect)
+{
+	Dirty.push_back(rect);
+}
+
+void frame_cache::invalidate()
+{
+	Everything = true;
+}
+
+// x, y in gl_FragCoord pixels
+void frame_cache::invalidate_mouse(const framebuffer &out, float x, float y)
+{
+	const float r = Traits.mouse_radius;
+	const float row = out.height - 1 - y;
+	invalidate({
+		static_cast<int>(std::floor(x - r)), static_cast<int>(std::floor(row - r)),
+		static_cast<int>(std::ceil(x + r)) + 1, static_cast<int>(std::ceil(row + r)) + 1
+	});
+}
+
+bool frame_cache::render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler)
+{
+	const auto &last = LastUniforms;
+	bool everything = Everything || !same(out, Last);
+	if (!Traits.time_invariant) {
+		everything |= u.time != last.time || u.time_delta != last.time_delta || u.frame != last.frame
+			|| memcmp(u.date, last.date, sizeof(u.date)) != 0;
+	}
+	if (memcmp(u.mouse, last.mouse, sizeof(u.mouse)) != 0) {
+		if (Traits.mouse_radius > 0.f) {
+			// the click position (zw) is negative while the button is up, it is still the same place
+			for (int i = 0; i < 4; i += 2) {
+				if (u.mouse[i] != last.mouse[i] || u.mouse[i + 1] != last.mouse[i + 1]) {
+					invalidate_mouse(out, std::abs(last.mouse[i]), std::abs(last.mouse[i + 1]));
+					invalidate_mouse(out, std::abs(u.mouse[i]), std::abs(u.mouse[i + 1]));
+				}
+			}
+		} else {
+			everything = true;
+		}
+	}
+
+	Last = out;
+	LastUniforms = u;
+	Everything = false;
+
+	if (everything) {
+		Dirty.clear();
+		shade(*Shader, out, u, scheduler);
+		Shaded = 1;
+		return true;
+	}
+
+	// clipped, and the overlapping ones merged so no pixel gets shaded twice
+	for (auto &rect : Dirty) {
+		rect = { std::max(rect.x_begin, 0), std::max(rect.y_begin, 0), std::min(rect.x_end, out.width), std::min(rect.y_end, out.height) };
+	}
+	Dirty.erase(std::remove_if(Dirty.begin(), Dirty.end(), [](const tile &t)
+	{
+		return t.x_begin >= t.x_end || t.y_begin >= t.y_end;
+	}), Dirty.end());
+	for (size_t i = 0; i < Dirty.size(); ++i) {
+		for (size_t j = i + 1; j < Dirty.size(); ++j) {
+			if (overlap(Dirty[i], Dirty[j])) {
+				auto &a = Dirty[i];
+				const auto &b = Dirty[j];
+				a = { std::min(a.x_begin, b.x_begin), std::min(a.y_begin, b.y_begin), std::max(a.x_end, b.x_end), std::max(a.y_end, b.y_end) };
+				Dirty.erase(Dirty.begin() + j);
+				j = i; // a grew, check everything again
+			}
+		}
+	}
+
+	float pixels = 0;
+	for (const auto &rect : Dirty) {
+		shade(*Shader, out, u, scheduler, rect);
+		pixels += static_cast<float>(rect.x_end - rect.x_begin) * (rect.y_end - rect.y_begin);
+	}
+	Shaded = pixels / (static_cast<float>(out.width) * out.height);
+
+	const bool shaded = !Dirty.empty();
+	Dirty.clear();
+	return shaded;
+}
+
+} } // namespace vml::render
@@ -0,0 +1,58 @@
+#pragma once
+
+// Frame reuse: render() shades into out only what the uniforms changed since the last render() into it
+// and nothing at all if they are the same, so an idle preview of a still picture costs no CPU
+//
+// by default any change of iTime, iTimeDelta, iFrame, iMouse, iDate or of the framebuffer shades the whole frame,
+// what the shader declares about itself (see kernel::shader_traits) narrows that down:
+// a time invariant shader ignores the clock and a mouse radius turns an iMouse change into dirty rectangles
+// around the old and the new positions; anything else the uniforms can't tell goes through invalidate()
+//
+// usage:
+//   frame_cache cache(kernel::select());
+//   if (cache.render(out, u, scheduler)) {
+//     present(out);
+//   }
+
+#include "render.h"
+
+#include <vector>
+
+namespace vml { namespace render {
+
+class frame_cache
+{
+public:
+	// narrowed down by the traits of the shader
+	explicit frame_cache(const kernel::entry_points &shader);
+
+	// what render() shades from now on, with its traits; the next render() shades everything
+	void shader(const kernel::entry_points &s);
+
+	const kernel::shader_traits& traits() const { return Traits; }
+
+	// returns false if nothing needed shading, out is then left as the last render() made it
+	bool render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler);
+
+	// the next render() shades at least these pixels (row 0 is the top) or everything
+	void invalidate(const tile &rect);
+	void invalidate();
+
+	// of the last frame, fraction of the pixels shaded
+	float shaded() const { return Shaded; }
+
+private:
+	const kernel::entry_points *Shader;
+	kernel::shader_traits Traits;
+
+	framebuffer Last = {};
+	uniforms LastUniforms = {};
+	bool Everything = true;
+	std::vector<tile> Dirty;
+
+	float Shaded = 0;
+
+	void invalidate_mouse(const framebuffer &out, float x, float y);
+};
+
+} } // namespace vml::render
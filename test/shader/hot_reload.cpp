@@ -0,0 +1,299 @@
+#include "hot_reload.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+namespace vml { namespace render {
+
+namespace {
+
+float milliseconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<float, std::milli>(d).count();
+}
+
+std::string directory_of(const std::string &path)
+{
+	const auto slash = path.find_last_of('/');
+	return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string absolute(const char *path)
+{
+#if defined(__linux__)
+	char resolved[PATH_MAX];
+	if (realpath(path, resolved)) {
+		return resolved;
+	}
+#endif
+	return path;
+}
+
+#if defined(__linux__)
+// runs args[0] (found in PATH) with its output into log, without a shell so nothing in the arguments is interpreted
+// returns its exit status, -1 if it couldn't be run or didn't exit
+int run(const std::vector<std::string> &args, const std::string &log)
+{
+	std::vector<char*> argv;
+	for (const auto &arg : args) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+	pid_t pid;
+	const int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (error != 0) {
+		return -1;
+	}
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			return -1;
+		}
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// the words of CXX, it may be a command with options like "ccache g++"
+std::vector<std::string> compiler_command()
+{
+	const char *compiler = getenv("CXX") && *getenv("CXX") ? getenv("CXX") : "c++";
+	std::vector<std::string> words;
+	std::string word;
+	for (const char *c = compiler; ; ++c) {
+		if (*c == ' ' || *c == '\t' || *c == '\0') {
+			if (!word.empty()) {
+				words.push_back(word);
+				word.clear();
+			}
+			if (!*c) {
+				break;
+			}
+		} else {
+			word += *c;
+		}
+	}
+	return words.empty() ? std::vector<std::string>{ "c++" } : words;
+}
+#endif
+
+} // anonymous namespace
+
+struct shader_reloader::library
+{
+	void *handle = nullptr;
+	const kernel::entry_points *entry = nullptr;
+	std::string path;
+	steady::time_point changed;
+	float build_ms = 0;
+
+	~library()
+	{
+#if defined(__linux__)
+		if (handle) {
+			dlclose(handle);
+		}
+		unlink(path.c_str());
+#endif
+	}
+};
+
+shader_reloader::shader_reloader(const char *shader_header, const char *kernel_source)
+	: Header(absolute(shader_header)),
+	Source(kernel_source ? absolute(kernel_source) : absolute((directory_of(__FILE__) + "/kernel.cpp").c_str()))
+{
+}
+
+shader_reloader::~shader_reloader()
+{
+	Stop.store(true);
+	if (Watcher.joinable()) {
+		Watcher.join();
+	}
+#if defined(__linux__)
+	Ready.reset();
+	Active.reset();
+	if (!Directory.empty()) {
+		// the build log and whatever a build left behind, rmdir() only removes it empty
+		if (DIR *dir = opendir(Directory.c_str())) {
+			while (const dirent *entry = readdir(dir)) {
+				const std::string name = entry->d_name;
+				if (name != "." && name != "..") {
+					unlink((Directory + "/" + name).c_str());
+				}
+			}
+			closedir(dir);
+		}
+		rmdir(Directory.c_str());
+	}
+#endif
+}
+
+bool shader_reloader::start()
+{
+#if defined(__linux__)
+	char directory[] = "/tmp/vml_hot_reload_XXXXXX";
+	if (!mkdtemp(directory)) {
+		return false;
+	}
+	Directory = directory;
+
+	const int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (fd < 0) {
+		return false;
+	}
+	// editors often save by writing another file and renaming it over
+	if (inotify_add_watch(fd, directory_of(Header).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(fd);
+		return false;
+	}
+
+	Watcher = std::thread([this, fd] { watch(fd); });
+	return true;
+#else
+	return false;
+#endif
+}
+
+void shader_reloader::watch(int fd)
+{
+#if defined(__linux__)
+	build(steady::now());
+
+	alignas(inotify_event) char events[4096];
+	while (!Stop.load()) {
+		pollfd p = { fd, POLLIN, 0 };
+		if (::poll(&p, 1, 100) <= 0) {
+			continue;
+		}
+
+		// a save is often a burst of events, build once after it
+		const auto changed = steady::now();
+		bool header = false;
+		do {
+			ssize_t size;
+			while ((size = read(fd, events, sizeof(events))) > 0) {
+				for (ssize_t i = 0; i < size; ) {
+					const auto event = reinterpret_cast<const inotify_event*>(events + i);
+					const std::string name = event->len ? event->name : "";
+					header |= name.size() > 2 && name.compare(name.size() - 2, 2, ".h") == 0;
+					i += sizeof(inotify_event) + event->len;
+				}
+			}
+			p.revents = 0;
+		} while (::poll(&p, 1, 30) > 0);
+
+		if (header) {
+			build(changed);
+		}
+	}
+	close(fd);
+#else
+	(void)fd;
+#endif
+}
+
+void shader_reloader::build(steady::time_point changed)
+{
+#if defined(__linux__)
+	auto lib = std::unique_ptr<library>(new library());
+	lib->path = Directory + "/shader_" + std::to_string(Builds++) + ".so";
+	lib->changed = changed;
+
+	// it goes into #include SHADER_HEADER as is, a header name has no escapes for these
+	if (Header.find_first_of("\"\n") != std::string::npos) {
+		printf("\n%s: can't be included, its path has a quote or a new line\n", Header.c_str());
+		return;
+	}
+
+	const std::string log = Directory + "/build.log";
+	auto command = compiler_command();
+	for (const char *option : { "-std=c++17", "-O2", "-march=native", "-fPIC", "-shared", "-fvisibility=hidden",
+		"-DKERNEL_EXPORT", "-DKERNEL_ISA=native", "-DKERNEL_SHADER=hot" }) {
+		command.push_back(option);
+	}
+	command.push_back("-DSHADER_HEADER=\"" + Header + "\"");
+	command.push_back("-o");
+	command.push_back(lib->path);
+	command.push_back(Source);
+
+	const auto start = steady::now();
+	const int status = run(command, log);
+	lib->build_ms = milliseconds(steady::now() - start);
+
+	if (status != 0) {
+		printf("\n%s failed to build (%s), still using the last one:\n", Header.c_str(),
+			status < 0 ? "the compiler didn't run" : ("exit status " + std::to_string(status)).c_str());
+		if (FILE *f = fopen(log.c_str(), "r")) {
+			char line[512];
+			for (int n = 0; n < 20 && fgets(line, sizeof(line), f); ++n) {
+				fputs(line, stdout);
+			}
+			fclose(f);
+		}
+		unlink(lib->path.c_str());
+		return;
+	}
+
+	lib->handle = dlopen(lib->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	using entry_func = const kernel::entry_points* (*)();
+	const auto entry = lib->handle ? reinterpret_cast<entry_func>(dlsym(lib->handle, "kernel_entry_points")) : nullptr;
+	if (!entry) {
+		printf("\n%s: %s\n", lib->path.c_str(), dlerror());
+		return;
+	}
+	lib->entry = entry();
+
+	std::lock_guard<std::mutex> lock(ReadyLock);
+	Ready = std::move(lib);
+#else
+	(void)changed;
+#endif
+}
+
+bool shader_reloader::poll()
+{
+	std::unique_ptr<library> ready;
+	{
+		std::lock_guard<std::mutex> lock(ReadyLock);
+		ready = std::move(Ready);
+	}
+	if (!ready) {
+		return false;
+	}
+
+	Latency = milliseconds(steady::now() - ready->changed);
+	BuildTime = ready->build_ms;
+	++Reloads;
+	Active = std::move(ready); // nothing runs the old code anymore
+	return true;
+}
+
+const kernel::entry_points* shader_reloader::shader() const
+{
+	return Active ? Active->entry : nullptr;
+}
+
+} } // namespace vml::render
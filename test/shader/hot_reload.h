@@ -0,0 +1,80 @@
+#pragma once
+
+// Hot reload: a shader header is built into a shared library in the background and swapped in between frames
+// the directory of the header is watched (inotify) so saving it or anything it includes next to it starts a rebuild,
+// the shader in use keeps rendering until a build succeeds and a failed one only prints the compiler's output
+// Linux only, elsewhere start() fails
+//
+// the library is kernel.cpp built with KERNEL_EXPORT and SHADER_HEADER, with the compiler of the CXX
+// environment variable (c++ by default) and -O2 -march=native
+//
+// usage:
+//   shader_reloader reloader("test/shader/ref/umbrellar.h");
+//   reloader.start();
+//   for (;;) {
+//     if (reloader.poll()) { ... the shader changed, *reloader.shader() is the new one ... }
+//     ... render a frame ...
+//   }
+
+#include "kernel.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace vml { namespace render {
+
+class shader_reloader
+{
+public:
+	// kernel_source: kernel.cpp, the one next to this file by default
+	explicit shader_reloader(const char *shader_header, const char *kernel_source = nullptr);
+	~shader_reloader();
+
+	shader_reloader(const shader_reloader &) = delete;
+	shader_reloader& operator =(const shader_reloader &) = delete;
+
+	// builds once and then on every change, false if watching is not possible
+	bool start();
+
+	// between frames, from the rendering thread: makes the last successful build the one shader() returns
+	// returns true when it did, the old library is unloaded so nothing may still use the shader before it
+	bool poll();
+
+	// of the last build poll() swapped in, nullptr before the first one; stays loaded until the next poll() swaps
+	const kernel::entry_points* shader() const;
+
+	// of the last reload, ms from the change on disk (or start()) to poll() swapping it in and of the build alone
+	float latency() const { return Latency; }
+	float build_time() const { return BuildTime; }
+	int reloads() const { return Reloads; }
+
+private:
+	using steady = std::chrono::steady_clock;
+
+	struct library;
+
+	std::string Header;
+	std::string Source;
+	std::string Directory;	// for the builds
+
+	std::atomic<bool> Stop { false };
+	std::thread Watcher;
+
+	std::mutex ReadyLock;
+	std::unique_ptr<library> Ready;		// built, not swapped in yet
+	std::unique_ptr<library> Active;	// in use
+
+	float Latency = 0;
+	float BuildTime = 0;
+	int Reloads = 0;
+	int Builds = 0;
+
+	void watch(int fd);
+	void build(steady::time_point changed);
+};
+
+} } // namespace vml::render
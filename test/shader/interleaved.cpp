@@ -0,0 +1,183 @@
+#include "interleaved.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace vml { namespace render {
+
+namespace {
+
+const float* history_pixel(const framebuffer &history, int x, int y)
+{
+	return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(history.pixels) + y * history.pitch) + x * 4;
+}
+
+void store(const framebuffer &out, int x, int y, const float rgba[4])
+{
+	auto row = reinterpret_cast<uint8_t*>(out.pixels) + y * out.pitch;
+	if (out.fmt == format::rgba32f) {
+		memcpy(reinterpret_cast<float*>(row) + x * 4, rgba, sizeof(float) * 4);
+		return;
+	}
+
+	const int channels = bytes_per_pixel(out.fmt);
+	for (int c = 0; c < channels; ++c) {
+		row[x * channels + c] = static_cast<uint8_t>(255 * std::clamp(rgba[c], 0.f, 1.f) + .5f);
+	}
+}
+
+} // anonymous namespace
+
+interleaved_renderer::interleaved_renderer(const kernel::entry_points &shader, pattern p, float threshold)
+	: Shader(&shader), Pattern(p), Threshold(threshold)
+{
+}
+
+void interleaved_renderer::shader(const kernel::entry_points &s)
+{
+	Shader = &s;
+	History.reset();
+}
+
+bool interleaved_renderer::invalidated(const framebuffer &out, const uniforms &u) const
+{
+	return !History || out.width != Width || out.height != Height
+		|| memcmp(u.mouse, Last.mouse, sizeof(u.mouse)) != 0
+		|| memcmp(u.date, Last.date, sizeof(u.date)) != 0
+		|| u.time < Last.time;
+}
+
+void interleaved_renderer::render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler)
+{
+	const bool everything = invalidated(out, u);
+	if (!History || out.width != Width || out.height != Height) {
+		Width = out.width;
+		Height = out.height;
+		QuadsX = (Width + 1) / 2;
+		QuadsY = (Height + 1) / 2;
+		History.reset(new image(Width, Height, format::rgba32f));
+	}
+	if (everything) {
+		Quads.assign(static_cast<size_t>(QuadsX) * QuadsY, quad_state());
+	}
+
+	const auto history = History->view();
+	const auto pattern = everything ? pattern::all : Pattern;
+	const int frame = Frame;
+	shade(*Shader, history, u, scheduler, pattern, frame);
+
+	// the rest of the work is per quad, so the tiles are in quads too
+	std::atomic<int> shaded { 0 }, reused { 0 };
+
+	// what changed since the last time these were shaded
+	scheduler.run(QuadsX, QuadsY, [&](const tile &t)
+	{
+		int count = 0;
+		for (int qy = t.y_begin; qy < t.y_end; ++qy) {
+			for (int qx = t.x_begin; qx < t.x_end; ++qx) {
+				if (!kernel::selected(pattern, frame, qx, qy)) {
+					continue;
+				}
+				++count;
+
+				float mean[3] = {};
+				int pixels = 0;
+				for (int y = qy * 2; y < std::min(qy * 2 + 2, Height); ++y) {
+					for (int x = qx * 2; x < std::min(qx * 2 + 2, Width); ++x, ++pixels) {
+						const auto p = history_pixel(history, x, y);
+						mean[0] += p[0];
+						mean[1] += p[1];
+						mean[2] += p[2];
+					}
+				}
+
+				auto &q = Quads[qy * QuadsX + qx];
+				float diff = 0;
+				for (int c = 0; c < 3; ++c) {
+					mean[c] /= pixels;
+					diff = std::max(diff, std::abs(mean[c] - q.mean[c]));
+					q.mean[c] = mean[c];
+				}
+				q.changed = q.frame < 0 || !(diff <= Threshold);
+				q.frame = frame;
+			}
+		}
+		shaded += count;
+	});
+
+	// fresh quads are copied, still ones reused, the others interpolated from the fresh ones around them
+	scheduler.run(QuadsX, QuadsY, [&](const tile &t)
+	{
+		int count = 0;
+		for (int qy = t.y_begin; qy < t.y_end; ++qy) {
+			for (int qx = t.x_begin; qx < t.x_end; ++qx) {
+				const int x_end = std::min(qx * 2 + 2, Width);
+				const int y_end = std::min(qy * 2 + 2, Height);
+				const auto &q = Quads[qy * QuadsX + qx];
+
+				bool fresh = q.frame == frame;
+				bool stale = q.frame < 0;
+				for (int ny = std::max(qy - 1, 0); ny <= std::min(qy + 1, QuadsY - 1) && !fresh && !stale; ++ny) {
+					for (int nx = std::max(qx - 1, 0); nx <= std::min(qx + 1, QuadsX - 1); ++nx) {
+						const auto &n = Quads[ny * QuadsX + nx];
+						stale |= n.frame == frame && n.changed;
+					}
+				}
+
+				if (!stale) {
+					count += fresh ? 0 : 1;
+					for (int y = qy * 2; y < y_end; ++y) {
+						for (int x = qx * 2; x < x_end; ++x) {
+							store(out, x, y, history_pixel(history, x, y));
+						}
+					}
+					continue;
+				}
+
+				for (int y = qy * 2; y < y_end; ++y) {
+					for (int x = qx * 2; x < x_end; ++x) {
+						float sum[4] = {}, weights = 0;
+						for (int ny = std::max(qy - 1, 0); ny <= std::min(qy + 1, QuadsY - 1); ++ny) {
+							for (int nx = std::max(qx - 1, 0); nx <= std::min(qx + 1, QuadsX - 1); ++nx) {
+								if (Quads[ny * QuadsX + nx].frame != frame) {
+									continue;
+								}
+								// closest pixel of that quad
+								const int sx = std::clamp(x, nx * 2, std::min(nx * 2 + 1, Width - 1));
+								const int sy = std::clamp(y, ny * 2, std::min(ny * 2 + 1, Height - 1));
+								const float w = 1.f / static_cast<float>((sx - x) * (sx - x) + (sy - y) * (sy - y));
+								const auto p = history_pixel(history, sx, sy);
+								for (int c = 0; c < 4; ++c) {
+									sum[c] += p[c] * w;
+								}
+								weights += w;
+							}
+						}
+
+						if (weights > 0) {
+							for (int c = 0; c < 4; ++c) {
+								sum[c] /= weights;
+							}
+							store(out, x, y, sum);
+						} else { // nothing fresh around, better old than nothing
+							store(out, x, y, history_pixel(history, x, y));
+						}
+					}
+				}
+			}
+		}
+		reused += count;
+	});
+
+	const float quads = static_cast<float>(QuadsX) * QuadsY;
+	Shaded = shaded / quads;
+	Reused = reused / quads;
+	Interpolated = 1.f - Shaded - Reused;
+
+	Last = u;
+	++Frame;
+}
+
+} } // namespace vml::render
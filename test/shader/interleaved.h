@@ -0,0 +1,66 @@
+#pragma once
+
+// Interleaved rendering: every frame shades only half (checkerboard) or a quarter (2x2 interleave) of the quads
+// and reconstructs the others from what they looked like the last time they were shaded
+//
+// an old quad is only reused if the freshly shaded quads around it still look the same as the last time,
+// anything that moved with iTime (or iMouse, ...) is interpolated from this frame's quads instead;
+// a change of resolution, iMouse, iDate or iTime going backwards throws the history away and shades everything
+// the quads are the same 2x2 ones as for the derivatives (see kernel::quad_pattern)
+
+#include "render.h"
+
+#include <memory>
+#include <vector>
+
+namespace vml { namespace render {
+
+class interleaved_renderer
+{
+public:
+	using pattern = kernel::quad_pattern;
+
+	// threshold: how much (per channel, 0..1) a quad may change between shadings and still count as still
+	explicit interleaved_renderer(const kernel::entry_points &shader, pattern p = pattern::checkerboard,
+		float threshold = 2.f / 255);
+
+	// what render() shades from now on, the history of the last one is thrown away
+	void shader(const kernel::entry_points &s);
+
+	// shades this frame's share of out and fills the rest
+	void render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler);
+
+	// of the last frame, in fractions of the quads
+	float shaded() const { return Shaded; }
+	float reused() const { return Reused; }
+	float interpolated() const { return Interpolated; }
+
+private:
+	struct quad_state
+	{
+		int frame = -1;	// last frame it was shaded, -1 if never
+		float mean[3] = {};
+		bool changed = true;
+	};
+
+	const kernel::entry_points *Shader;
+	pattern Pattern;
+	float Threshold;
+	int Frame = 0;
+	uniforms Last = {};
+
+	int Width = 0;
+	int Height = 0;
+	int QuadsX = 0;
+	int QuadsY = 0;
+	std::unique_ptr<image> History; // float rgba, the quads as they were last shaded
+	std::vector<quad_state> Quads;
+
+	float Shaded = 0;
+	float Reused = 0;
+	float Interpolated = 0;
+
+	bool invalidated(const framebuffer &out, const uniforms &u) const;
+};
+
+} } // namespace vml::render
@@ -0,0 +1,275 @@
+// The shader translation unit
+// config #define's
+// KERNEL_ISA (generic, avx2, avx512) - along with the matching compiler flags
+// KERNEL_SHADER - its name in the registry (see shaders.h), app by default
+// KERNEL_EXPORT - built as a shared library, kernel_entry_points() hands out the variant (see hot_reload.h)
+// APP_??? (see sandbox.h)
+// VML_CONSTANT_LITERALS (see sandbox.h)
+// VML_LUT_SIN, VML_LUT_COS, VML_LUT_EXP2, VML_LUT_LOG2 (see vml/detail/lut.h)
+//
+// pixels are shaded in 2x2 quads so dFdx/dFdy/fwidth are real (see vml/detail/quad.h)
+
+#include "kernel.h"
+
+#ifndef KERNEL_ISA
+#define KERNEL_ISA generic
+#endif
+#ifndef KERNEL_SHADER
+#define KERNEL_SHADER app
+#endif
+
+#define KERNEL_CONCAT_IMPL(a, b) a##b
+#define KERNEL_CONCAT(a, b) KERNEL_CONCAT_IMPL(a, b)
+#define KERNEL_VARIANT KERNEL_CONCAT(KERNEL_SHADER, KERNEL_CONCAT(_, KERNEL_ISA))
+
+// every variant gets its own copy of vml and the shader
+// otherwise the linker would merge the inline functions compiled for different instruction sets or shaders
+// (the std:: and kernel:: ones it can't rename are renamed in the object, see cmake/kernel_symbols.cmake)
+#define vml KERNEL_CONCAT(vml_, KERNEL_VARIANT)
+#define sandbox KERNEL_CONCAT(sandbox_, KERNEL_VARIANT)
+
+#define VML_QUAD_SHADING
+#include "sandbox.h"
+
+namespace kernel { namespace KERNEL_VARIANT {
+
+#ifndef SHADER_MOUSE_RADIUS
+#define SHADER_MOUSE_RADIUS 0
+#endif
+#ifndef SHADER_BUFFERS
+#define SHADER_BUFFERS 0
+#endif
+static_assert(SHADER_BUFFERS >= 0 && SHADER_BUFFERS <= 4, "Buffer A to D at most");
+
+extern const shader_traits traits = {
+#ifdef SHADER_TIME_INVARIANT
+	true,
+#else
+	false,
+#endif
+	static_cast<float>(SHADER_MOUSE_RADIUS),
+	SHADER_BUFFERS,
+#ifdef SHADER_CUBEMAP
+	true,
+#else
+	false,
+#endif
+};
+
+namespace {
+
+// sampled where it is
+sandbox::channel_sampler sampler_of(const channel *channels, int index)
+{
+	sandbox::channel_sampler sampler;
+	if (!channels || !channels[index].levels) {
+		return sampler;
+	}
+	const channel &c = channels[index];
+	vml::texture_level levels[vml::max_texture_levels];
+	const int count = c.count < vml::max_texture_levels ? c.count : vml::max_texture_levels;
+	for (int i = 0; i < count; ++i) {
+		const channel_level &l = c.levels[i];
+		levels[i] = { l.texels, { l.size[0], l.size[1], l.size[2] }, { l.pitch[0], l.pitch[1] },
+			static_cast<vml::texture_layout>(l.layout), l.bits };
+	}
+	const vml::sampler_state state = { static_cast<vml::filter>(c.filter), static_cast<vml::wrap>(c.wrap) };
+	if (c.type == channel_type::cubemap) {
+		sampler.cube = samplerCube(levels, count, state);
+	} else if (c.type == channel_type::texture_3d) {
+		sampler.volume = sampler3D(levels, count, state);
+	} else {
+		sampler.flat = sampler2D(levels, count, state);
+	}
+	return sampler;
+}
+
+sandbox::uniform_context context_of(const uniforms &u, const channel *channels)
+{
+	sandbox::uniform_context ctx = {};
+	ctx.iResolution = vec3(u.resolution[0], u.resolution[1], u.resolution[2]);
+	ctx.iTime = u.time;
+	ctx.iTimeDelta = u.time_delta;
+	ctx.iFrame = u.frame;
+	ctx.iMouse = vec4(u.mouse[0], u.mouse[1], u.mouse[2], u.mouse[3]);
+	ctx.iDate = vec4(u.date[0], u.date[1], u.date[2], u.date[3]);
+	ctx.iChannel0 = sampler_of(channels, 0);
+	ctx.iChannel1 = sampler_of(channels, 1);
+	ctx.iChannel2 = sampler_of(channels, 2);
+	ctx.iChannel3 = sampler_of(channels, 3);
+	const sandbox::channel_sampler *samplers[max_channels] = { &ctx.iChannel0, &ctx.iChannel1, &ctx.iChannel2, &ctx.iChannel3 };
+	for (int i = 0; i < max_channels; ++i) {
+		const auto &s = *samplers[i];
+		const auto &level = s.cube.bound() ? s.cube.level(0) : s.volume.bound() ? s.volume.level(0) : s.flat.level(0);
+		ctx.iChannelResolution[i] = vec3(static_cast<float>(level.size[0]), static_cast<float>(level.size[1]),
+			s.volume.bound() ? static_cast<float>(level.size[2]) : 1.0f);
+	}
+	return ctx;
+}
+
+using main_function = void (sandbox::fragment_shader::*)(vec4 &fragColor, vec2 fragCoord);
+
+// only the passes the shader has are referenced, the others aren't defined
+main_function main_of(shader_pass pass)
+{
+	switch (pass) {
+#if SHADER_BUFFERS > 0
+	case shader_pass::buffer_a:
+		return &sandbox::fragment_shader::buffer_a;
+#endif
+#if SHADER_BUFFERS > 1
+	case shader_pass::buffer_b:
+		return &sandbox::fragment_shader::buffer_b;
+#endif
+#if SHADER_BUFFERS > 2
+	case shader_pass::buffer_c:
+		return &sandbox::fragment_shader::buffer_c;
+#endif
+#if SHADER_BUFFERS > 3
+	case shader_pass::buffer_d:
+		return &sandbox::fragment_shader::buffer_d;
+#endif
+	default:
+		return &sandbox::fragment_shader::main;
+	}
+}
+
+#ifdef SHADER_CUBEMAP
+// Shadertoy's Cube A: from the center of the cube through the pixel of the face
+vec3 ray_direction(cube_face face, vec2 frag_coord, float size)
+{
+	float d[3];
+	vml::detail::sampling::cube_direction(static_cast<int>(face), frag_coord.x / size, frag_coord.y / size, d);
+	return vec3(d[0], d[1], d[2]);
+}
+#endif
+
+template<pixel_format format>
+void store(uint8_t *ptr, const vec4 &frag_color)
+{
+	if constexpr (format == pixel_format::rgba32f) {
+		auto out = reinterpret_cast<float*>(ptr);
+		out[0] = frag_color.r;
+		out[1] = frag_color.g;
+		out[2] = frag_color.b;
+		out[3] = frag_color.a;
+	} else {
+		const auto color = sandbox::clamp(frag_color, 0.0f, 1.0f);
+		*ptr++ = static_cast<uint8_t>(255 * color.r + 0.5f);
+		*ptr++ = static_cast<uint8_t>(255 * color.g + 0.5f);
+		*ptr++ = static_cast<uint8_t>(255 * color.b + 0.5f);
+		if constexpr (format == pixel_format::rgba8) {
+			*ptr++ = static_cast<uint8_t>(255 * color.a + 0.5f);
+		}
+	}
+}
+
+// quads are aligned on even pixels so tiles of any size agree on them
+// lanes outside of the rectangle (or the bitmap) are shaded as helpers and not stored, like on the GPU
+template<pixel_format format>
+void shade_rect(const shade_job &job)
+{
+	constexpr int bytes_per_pixel = format == pixel_format::rgb8 ? 3 : format == pixel_format::rgba8 ? 4 : 16;
+
+	// the job's uniforms are this thread's until it is done
+	const sandbox::uniform_context context = context_of(*job.inputs, job.channels);
+	const auto outer = sandbox::current_uniforms;
+	sandbox::current_uniforms = &context;
+
+	sandbox::fragment_shader shader;
+	const main_function main = main_of(job.pass); // a pass the shader doesn't have shades the image
+	vml::detail::quad::context quad;
+	quad.scale = 1.f / job.step; // derivatives stay per shader pixel on coarse passes
+	const auto samples = offsets(job.samples);
+	vec4 colors[4], sample_colors[4];
+
+	for (int y0 = job.y_begin & ~1; y0 < job.y_end; y0 += 2) {
+		for (int x0 = job.x_begin & ~1; x0 < job.x_end; x0 += 2) {
+			if (!selected(job.pattern, job.phase, x0 / 2, y0 / 2)) {
+				continue;
+			}
+
+			// the whole quad moves by the offset of the sample so the derivatives are still across pixels
+			for (int sample = 0; sample < samples.count; ++sample) {
+				const vec2 offset = vec2(samples.xy[sample][0], samples.xy[sample][1]);
+				vml::detail::quad::shade(quad, [&](int lane)
+				{
+					const int x = x0 + (lane & 1);
+					const int y = y0 + 1 - (lane >> 1); // lanes 2 and 3 are the upper row
+					shader.gl_FragCoord = vec2(static_cast<float>(x * job.step), job.frag_height - 1.0f - y * job.step) + offset;
+#ifdef SHADER_CUBEMAP
+					if (job.pass == shader_pass::cubemap) {
+						// through the center of the texel, where the samplers take it to be
+						shader.cubemap(shader.gl_FragColor, shader.gl_FragCoord, vec3(0.0f),
+							ray_direction(job.face, shader.gl_FragCoord + 0.5f, static_cast<float>(job.frag_height)));
+					} else
+#endif
+					(shader.*main)(shader.gl_FragColor, shader.gl_FragCoord);
+					sample_colors[lane] = shader.gl_FragColor;
+				});
+
+				// only the last pass of quad::shade() counts, so the samples add up after it
+				for (int lane = 0; lane < 4; ++lane) {
+					vec4 color = sample_colors[lane];
+					if constexpr (format != pixel_format::rgba32f) {
+						color = sandbox::clamp(color, 0.0f, 1.0f);
+					}
+					colors[lane] = sample == 0 ? color : colors[lane] + color;
+				}
+			}
+			if (samples.count > 1) {
+				for (int lane = 0; lane < 4; ++lane) {
+					colors[lane] *= 1.0f / samples.count;
+				}
+			}
+
+			for (int lane = 0; lane < 4; ++lane) {
+				const int x = x0 + (lane & 1);
+				const int y = y0 + 1 - (lane >> 1);
+				if (x >= job.x_begin && x < job.x_end && y >= job.y_begin && y < job.y_end) {
+					store<format>(reinterpret_cast<uint8_t*>(job.pixels) + y * job.pitch + x * bytes_per_pixel, colors[lane]);
+				}
+			}
+		}
+	}
+
+	sandbox::current_uniforms = outer;
+}
+
+} // anonymous namespace
+
+void shade_rect(const shade_job &job)
+{
+	switch (job.format) {
+	case pixel_format::rgb8:
+		shade_rect<pixel_format::rgb8>(job);
+		break;
+	case pixel_format::rgba8:
+		shade_rect<pixel_format::rgba8>(job);
+		break;
+	case pixel_format::rgba32f:
+		shade_rect<pixel_format::rgba32f>(job);
+		break;
+	}
+}
+
+} } // namespace kernel::KERNEL_VARIANT
+
+#ifdef KERNEL_EXPORT
+#define KERNEL_STRING_IMPL(a) #a
+#define KERNEL_STRING(a) KERNEL_STRING_IMPL(a)
+
+#if defined(_WIN32)
+#define KERNEL_EXPORT_API __declspec(dllexport)
+#else
+#define KERNEL_EXPORT_API __attribute__((visibility("default")))
+#endif
+
+extern "C" KERNEL_EXPORT_API const kernel::entry_points* kernel_entry_points()
+{
+	static const kernel::entry_points entry = {
+		KERNEL_STRING(KERNEL_SHADER), KERNEL_STRING(KERNEL_ISA), &kernel::KERNEL_VARIANT::traits, kernel::KERNEL_VARIANT::shade_rect
+	};
+	return &entry;
+}
+#endif
@@ -0,0 +1,206 @@
+#pragma once
+
+// Interface to the shader translation unit (kernel.cpp)
+// It gets compiled once per instruction set and the best one is picked at startup
+// so nothing in here can depend on vml types: each variant has its own copy of them
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+
+struct uniforms
+{
+	float resolution[3];	// viewport resolution (in pixels)
+	float time;				// shader playback time (in seconds)
+	float time_delta;		// render time (in seconds)
+	int frame;				// shader playback frame
+	float mouse[4];			// mouse pixel coords. xy: current (if MLB down), zw: click
+	float date[4];			// (year, month, day, time in seconds)
+};
+
+enum class pixel_format
+{
+	rgb8,		// 3 bytes, clamped to [0, 1]
+	rgba8,		// 4 bytes, clamped to [0, 1]
+	rgba32f,	// 4 floats, as the shader wrote them
+};
+
+// which 2x2 quads shade_rect() shades, in quad coordinates (x / 2, y / 2) of the bitmap
+// pixels of the other quads are left as they are
+enum class quad_pattern
+{
+	all,
+	checkerboard,	// (qx + qy) & 1 == phase & 1
+	interleave_2x2,	// (qx & 1) | (qy & 1) << 1 == phase & 3
+};
+
+constexpr bool selected(quad_pattern pattern, int phase, int qx, int qy)
+{
+	return pattern == quad_pattern::checkerboard ? ((qx + qy) & 1) == (phase & 1)
+		: pattern == quad_pattern::interleave_2x2 ? ((qx & 1) | (qy & 1) << 1) == (phase & 3)
+		: true;
+}
+
+// supersampling, every pixel is the average of main() at these offsets (in pixels) from where it is sampled otherwise
+// the average is taken in registers, no sample ever gets to memory; 8-bit formats clamp the samples first like a GPU resolve
+enum class sample_pattern
+{
+	none,			// 1 sample
+	rotated_grid,	// 4 samples, RGSS
+	rooks,			// 8 samples, no 2 on the same row or column (D3D's standard 8x MSAA pattern)
+	stratified,		// 16 samples, jittered 4x4 grid
+};
+
+struct sample_offsets
+{
+	int count;
+	const float (*xy)[2];
+};
+
+inline constexpr float rotated_grid_offsets[4][2] = {
+	{ .125f, .375f }, { .375f, -.125f }, { -.125f, -.375f }, { -.375f, .125f }
+};
+inline constexpr float rooks_offsets[8][2] = {
+	{ 1 / 16.f, -3 / 16.f }, { -1 / 16.f, 3 / 16.f }, { 5 / 16.f, 1 / 16.f }, { -3 / 16.f, -5 / 16.f },
+	{ -5 / 16.f, 5 / 16.f }, { -7 / 16.f, -1 / 16.f }, { 3 / 16.f, 7 / 16.f }, { 7 / 16.f, -7 / 16.f }
+};
+inline constexpr float stratified_offsets[16][2] = {
+	{ -.40625f, -.4375f }, { -.125f, -.3125f }, { .03125f, -.46875f }, { .46875f, -.34375f },
+	{ -.46875f, -.15625f }, { -.09375f, -.21875f }, { .15625f, -.1875f }, { .28125f, -.21875f },
+	{ -.375f, .125f }, { -.21875f, .0625f }, { .03125f, .15625f }, { .375f, .03125f },
+	{ -.28125f, .40625f }, { -.21875f, .3125f }, { .1875f, .4375f }, { .40625f, .28125f }
+};
+inline constexpr float no_offset[1][2] = { { 0.f, 0.f } };
+
+constexpr sample_offsets offsets(sample_pattern pattern)
+{
+	return pattern == sample_pattern::rotated_grid ? sample_offsets { 4, rotated_grid_offsets }
+		: pattern == sample_pattern::rooks ? sample_offsets { 8, rooks_offsets }
+		: pattern == sample_pattern::stratified ? sample_offsets { 16, stratified_offsets }
+		: sample_offsets { 1, no_offset };
+}
+
+// the passes of a multipass shader (see SHADER_BUFFERS in sandbox.h) in the order they run every frame
+// Shadertoy's Buffer A to D, then the image; a single pass shader only has the image one
+// and Cube A (see SHADER_CUBEMAP), baked once rather than every frame
+enum class shader_pass
+{
+	buffer_a,
+	buffer_b,
+	buffer_c,
+	buffer_d,
+	image,
+	cubemap,
+};
+
+// the faces of a cubemap in GL's order, the job of a cubemap pass shades one of them
+enum class cube_face
+{
+	positive_x,
+	negative_x,
+	positive_y,
+	negative_y,
+	positive_z,
+	negative_z,
+};
+
+// what a pass reads as iChannel0..3 (texture, texelFetch, ...): levels of float rgba texels and how to filter them
+// the same as vml::texture_level and vml::sampler_state (see vml/sampler.h) without the vml types
+struct channel_level
+{
+	const float *texels;
+	int size[3];			// width, height, depth
+	ptrdiff_t pitch[2];		// in bytes, between rows and between slices, row 0 is the bottom like texture coordinates
+							// so a framebuffer (row 0 the top) is read from its last row with a negative pitch
+	int layout;				// vml::texture_layout
+	int bits;
+};
+
+// what the levels are, a shader reads 2D textures with vec2 coordinates, 3D ones and cubemaps with vec3
+enum class channel_type
+{
+	texture_2d,
+	cubemap,	// every level has the six faces as its slices, like vml::cubemap_storage
+	texture_3d,	// every level is half the size of the one before on all three axes, like vml::texture_storage<3>
+};
+
+struct channel
+{
+	const channel_level *levels;	// the base level first, nullptr if nothing is bound (it reads as 0)
+	int count;
+	int filter;						// vml::filter
+	int wrap;						// vml::wrap
+	channel_type type = channel_type::texture_2d;
+};
+
+constexpr int max_channels = 4;
+
+// a rectangle of a bitmap to shade, row 0 is the top
+struct shade_job
+{
+	const uniforms *inputs;	// what the shader sees as iResolution, iTime, ... while shading this job
+	void *pixels;
+	int pitch;				// in bytes
+	pixel_format format;
+	int width;				// of the bitmap
+	int height;
+	int x_begin;			// [x_begin, x_end) x [y_begin, y_end) gets shaded
+	int y_begin;
+	int x_end;
+	int y_end;
+	quad_pattern pattern;
+	int phase;
+	int step;				// bitmap pixel (x, y) is shader pixel (x, y) * step, > 1 for coarse passes
+	int frag_height;		// in shader pixels, gl_FragCoord.y = frag_height - 1 - y * step
+	sample_pattern samples = sample_pattern::none;
+	shader_pass pass = shader_pass::image;
+	const channel *channels = nullptr;	// [max_channels], nullptr if none is bound
+	cube_face face = cube_face::positive_x;	// of a cubemap pass, the bitmap is that face (row 0 is its t = 1 edge)
+};
+
+// what the shader declares about itself, see the SHADER_* #define's in sandbox.h
+struct shader_traits
+{
+	bool time_invariant;	// iTime, iTimeDelta, iFrame and iDate don't change the picture
+	float mouse_radius;		// > 0: iMouse only changes the pixels this close to its xy and zw, 0: it can change any of them
+	int buffers;			// buffer passes before the image one, 0 for a single pass shader
+	bool cubemap;			// has a cubemap pass
+};
+
+struct entry_points
+{
+	const char *shader;
+	const char *isa;
+	const shader_traits *traits;
+
+	// thread safe, any jobs can run in parallel, of the same frame or not
+	void (*shade_rect)(const shade_job &job);
+};
+
+// for the translation units that pick between variants
+#define KERNEL_DECLARE(name) \
+namespace kernel { namespace name { \
+	extern const shader_traits traits; \
+	void shade_rect(const shade_job &job); \
+} }
+
+// the best variant of the shader in use (see use()) the CPU supports
+// the VML_ISA environment variable (generic, avx2, avx512) overrides the choice for benchmarking
+const entry_points& select();
+
+// the best variant of a shader of the registry (see shaders.h), nullptr if there is no such shader
+const entry_points* find(const char *shader);
+
+// the names in the registry, nullptr past the last one
+const char* shader_name(int index);
+
+// the shader select() returns from now on, false (and no change) if there is no such shader
+// the first one of the registry unless the VML_SHADER environment variable names another
+// not thread safe with rendering, call it between frames
+bool use(const char *shader);
+
+// same with a shader from outside of the registry (see hot_reload.h), it has to stay loaded while in use
+void use(const entry_points &shader);
+
+} // namespace kernel
@@ -0,0 +1,213 @@
+// Picks one of the kernel.cpp variants at startup
+// must be compiled with the baseline flags, it runs before we know what the CPU supports
+// config #define's
+// KERNEL_HAS_AVX2
+// KERNEL_HAS_AVX512
+// KERNEL_REGISTRY - every shader of shaders.h is linked in, otherwise just the one sandbox.h picked (as app)
+
+#include "kernel.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef KERNEL_REGISTRY
+#include "shaders.h"
+#else
+#define KERNEL_SHADERS(X) X(app, ) // just the one sandbox.h picks, see APP_???
+#endif
+
+#ifdef KERNEL_HAS_AVX2
+#define KERNEL_IF_AVX2(...) __VA_ARGS__
+#else
+#define KERNEL_IF_AVX2(...)
+#endif
+#ifdef KERNEL_HAS_AVX512
+#define KERNEL_IF_AVX512(...) __VA_ARGS__
+#else
+#define KERNEL_IF_AVX512(...)
+#endif
+
+#define KERNEL_DECLARE_SHADER(shader, define) \
+	KERNEL_DECLARE(shader##_generic) \
+	KERNEL_IF_AVX2(KERNEL_DECLARE(shader##_avx2)) \
+	KERNEL_IF_AVX512(KERNEL_DECLARE(shader##_avx512))
+
+KERNEL_SHADERS(KERNEL_DECLARE_SHADER)
+
+namespace kernel {
+
+namespace {
+
+#define KERNEL_VARIANTS(shader, define) \
+const entry_points shader##_variants[] = { /* best last */ \
+	{ #shader, "generic", &shader##_generic::traits, shader##_generic::shade_rect }, \
+	KERNEL_IF_AVX2({ #shader, "avx2", &shader##_avx2::traits, shader##_avx2::shade_rect },) \
+	KERNEL_IF_AVX512({ #shader, "avx512", &shader##_avx512::traits, shader##_avx512::shade_rect },) \
+};
+
+KERNEL_SHADERS(KERNEL_VARIANTS)
+
+struct registered_shader
+{
+	const char *name;
+	const entry_points *variants;
+	size_t count;
+};
+
+#define KERNEL_REGISTER(shader, define) { #shader, shader##_variants, sizeof(shader##_variants) / sizeof(shader##_variants[0]) },
+
+const registered_shader registry[] = {
+	KERNEL_SHADERS(KERNEL_REGISTER)
+};
+
+#undef KERNEL_DECLARE_SHADER
+#undef KERNEL_VARIANTS
+#undef KERNEL_REGISTER
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+bool cpu_supports(const char *isa)
+{
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+	if (max_leaf < 7) {
+		return false;
+	}
+
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool fma = (info[2] & (1 << 12)) != 0;
+	if (!osxsave) {
+		return false;
+	}
+	const auto xcr0 = _xgetbv(0);
+	const bool os_avx = (xcr0 & 0x6) == 0x6; // XMM and YMM state
+	const bool os_avx512 = (xcr0 & 0xe6) == 0xe6; // and opmask, ZMM state
+
+	__cpuidex(info, 7, 0);
+	const bool avx2 = (info[1] & (1 << 5)) != 0 && (info[1] & (1 << 8)) != 0; // and BMI2, every AVX2 CPU has it
+	const bool avx512 = (info[1] & (1 << 16)) && (info[1] & (1 << 17)) // F DQ
+		&& (info[1] & (1 << 30)) && (info[1] & (1 << 31)); // BW VL
+
+	if (strcmp(isa, "avx2") == 0) {
+		return os_avx && avx2 && fma;
+	}
+	if (strcmp(isa, "avx512") == 0) {
+		return os_avx512 && avx512 && avx2 && fma;
+	}
+	return false;
+}
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+bool cpu_supports(const char *isa)
+{
+	__builtin_cpu_init();
+	if (strcmp(isa, "avx2") == 0) {
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+	}
+	if (strcmp(isa, "avx512") == 0) {
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+			&& __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("bmi2");
+	}
+	return false;
+}
+#else
+bool cpu_supports(const char *)
+{
+	return false;
+}
+#endif
+
+// every shader is built for the same instruction sets, so this is the same index for all of them
+size_t pick_isa()
+{
+	const auto &variants = registry[0];
+
+	if (const char *forced = getenv("VML_ISA")) {
+		for (size_t i = 0; i < variants.count; ++i) {
+			if (strcmp(variants.variants[i].isa, forced) == 0) {
+				if (i != 0 && !cpu_supports(forced)) {
+					printf("VML_ISA=%s is not supported by this CPU\n", forced);
+					break;
+				}
+				return i;
+			}
+		}
+		printf("VML_ISA=%s ignored\n", forced);
+	}
+
+	for (auto i = variants.count - 1; i > 0; --i) {
+		if (cpu_supports(variants.variants[i].isa)) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+size_t isa_index()
+{
+	static const size_t index = pick_isa();
+	return index;
+}
+
+const entry_points* pick()
+{
+	if (const char *name = getenv("VML_SHADER")) {
+		if (const entry_points *shader = find(name)) {
+			return shader;
+		}
+		printf("VML_SHADER=%s ignored\n", name);
+	}
+	return &registry[0].variants[isa_index()];
+}
+
+std::atomic<const entry_points*>& in_use()
+{
+	static std::atomic<const entry_points*> shader { pick() };
+	return shader;
+}
+
+} // anonymous namespace
+
+const entry_points& select()
+{
+	return *in_use().load(std::memory_order_relaxed);
+}
+
+const entry_points* find(const char *shader)
+{
+	for (const auto &r : registry) {
+		if (strcmp(r.name, shader) == 0) {
+			return &r.variants[isa_index()];
+		}
+	}
+	return nullptr;
+}
+
+const char* shader_name(int index)
+{
+	constexpr int count = sizeof(registry) / sizeof(registry[0]);
+	return index >= 0 && index < count ? registry[index].name : nullptr;
+}
+
+bool use(const char *shader)
+{
+	const entry_points *found = find(shader);
+	if (found) {
+		in_use().store(found, std::memory_order_relaxed);
+	}
+	return found != nullptr;
+}
+
+void use(const entry_points &shader)
+{
+	in_use().store(&shader, std::memory_order_relaxed);
+}
+
+} // namespace kernel
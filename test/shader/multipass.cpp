@@ -0,0 +1,129 @@
+#include "multipass.h"
+
+#include "../../vml/sampler.h"
+
+#include <utility>
+
+namespace vml { namespace render {
+
+namespace {
+
+// bottom row first, the way texture coordinates go
+kernel::channel_level level_of(const framebuffer &fb)
+{
+	const auto last_row = reinterpret_cast<const uint8_t*>(fb.pixels) + (fb.height - 1) * fb.pitch;
+	return { reinterpret_cast<const float*>(last_row), { fb.width, fb.height, 1 }, { -fb.pitch, 0 },
+		static_cast<int>(vml::texture_layout::linear), 0 };
+}
+
+} // anonymous namespace
+
+multipass_renderer::multipass_renderer(const kernel::entry_points &shader, int cubemap_size)
+	: Shader(&shader), Buffers(shader.traits->buffers)
+{
+	if (shader.traits->cubemap) {
+		Cube.reset(new baked_cubemap(cubemap_size));
+	}
+
+	for (int pass = 0; pass < passes; ++pass) {
+		for (int channel = 0; channel < kernel::max_channels; ++channel) {
+			const bool cube = Cube && channel == Buffers && pass != static_cast<int>(kernel::shader_pass::cubemap);
+			Bindings[pass][channel] = { channel < Buffers ? channel : cube ? cube_a : unbound, {} };
+		}
+	}
+}
+
+void multipass_renderer::bind(kernel::shader_pass pass, int channel, int buffer)
+{
+	if (channel >= 0 && channel < kernel::max_channels) {
+		const bool valid = (buffer >= 0 && buffer < Buffers) || (buffer == cube_a && Cube);
+		Bindings[static_cast<int>(pass)][channel] = { valid ? buffer : unbound, {} };
+	}
+}
+
+void multipass_renderer::bind(kernel::shader_pass pass, int channel, const kernel::channel &texture)
+{
+	if (channel >= 0 && channel < kernel::max_channels) {
+		Bindings[static_cast<int>(pass)][channel] = { unbound, texture };
+	}
+}
+
+void multipass_renderer::reset()
+{
+	Width = 0;
+	Height = 0;
+	Baked = false;
+}
+
+framebuffer multipass_renderer::buffer(int index) const
+{
+	return Front[index]->view();
+}
+
+// buffers: where the levels of the buffers go, channels point into it
+void multipass_renderer::channels_of(kernel::shader_pass pass, kernel::channel_level (&buffers)[kernel::max_channels],
+	kernel::channel (&channels)[kernel::max_channels]) const
+{
+	// Shadertoy's defaults for buffers
+	constexpr int bilinear = static_cast<int>(vml::filter::bilinear), clamp = static_cast<int>(vml::wrap::clamp);
+
+	for (int channel = 0; channel < kernel::max_channels; ++channel) {
+		const auto &binding = Bindings[static_cast<int>(pass)][channel];
+		if (binding.buffer == cube_a) {
+			channels[channel] = Cube->channel();
+		} else if (binding.buffer != unbound) {
+			buffers[channel] = level_of(Front[binding.buffer]->view());
+			channels[channel] = { &buffers[channel], 1, bilinear, clamp };
+		} else {
+			channels[channel] = binding.texture;
+		}
+	}
+}
+
+void multipass_renderer::shade_pass(const framebuffer &fb, const uniforms &u, tile_scheduler &scheduler,
+	kernel::shader_pass pass) const
+{
+	kernel::channel_level buffers[kernel::max_channels];
+	kernel::channel channels[kernel::max_channels];
+	channels_of(pass, buffers, channels);
+	shade(*Shader, fb, u, scheduler, pass, channels);
+}
+
+void multipass_renderer::render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler)
+{
+	if (out.width != Width || out.height != Height) {
+		Width = out.width;
+		Height = out.height;
+		for (int i = 0; i < Buffers; ++i) {
+			Front[i].reset(new image(Width, Height, format::rgba32f));
+			Back[i].reset(new image(Width, Height, format::rgba32f));
+		}
+	}
+
+	// before the buffers are shaded into, a cubemap pass reading them sees them all zero like on the first frame
+	bake(u, scheduler);
+
+	for (int i = 0; i < Buffers; ++i) {
+		shade_pass(Back[i]->view(), u, scheduler, static_cast<kernel::shader_pass>(i));
+		std::swap(Front[i], Back[i]);
+	}
+	shade_pass(out, u, scheduler, kernel::shader_pass::image);
+}
+
+void multipass_renderer::bake(const uniforms &u, tile_scheduler &scheduler)
+{
+	if (Cube && !Baked) {
+		kernel::channel_level buffers[kernel::max_channels];
+		kernel::channel channels[kernel::max_channels];
+		channels_of(kernel::shader_pass::cubemap, buffers, channels);
+		Cube->bake(*Shader, u, scheduler, channels);
+		Baked = true;
+	}
+}
+
+void multipass_renderer::render_image(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler) const
+{
+	shade_pass(out, u, scheduler, kernel::shader_pass::image);
+}
+
+} } // namespace vml::render
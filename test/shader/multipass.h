@@ -0,0 +1,93 @@
+#pragma once
+
+// Multipass shaders: Shadertoy's Buffer A to D (see SHADER_BUFFERS in sandbox.h)
+// every frame the buffer passes run in order, each one into a float rgba buffer the size of the output,
+// then the image pass shades the output; all of them read the buffers through iChannel0..3
+//
+// a channel can also be any other texture, like the files of texture_file.h
+// a shader with a cubemap pass (see SHADER_CUBEMAP) has it baked once before its first frame (see cubemap.h),
+// the channel after its buffers reads it in all the other passes
+//
+// the buffers are double buffered: a pass writes its back buffer which is then swapped with the front one,
+// so the passes after it read this frame's result and the ones up to it (itself included) the last frame's, like on Shadertoy
+// the swap is of the pointers, nothing gets copied
+// every pass is spread over the tiles of the scheduler and done before the next one starts
+//
+// usage:
+//   multipass_renderer passes(kernel::select()); // iChannel0 is Buffer A, iChannel1 Buffer B, ...
+//   passes.bind(kernel::shader_pass::image, 0, 2); // the image pass reads Buffer C as iChannel0
+//   passes.bind(kernel::shader_pass::buffer_a, 1, noise->channel()); // and Buffer A a texture as iChannel1
+//   passes.render(out, u, scheduler);	// once per frame, u.frame counting up from 0
+
+#include "render.h"
+#include "cubemap.h"
+
+#include <memory>
+
+namespace vml { namespace render {
+
+class multipass_renderer
+{
+public:
+	static constexpr int max_buffers = 4;
+	static constexpr int passes = max_buffers + 2;	// the buffers, image and cubemap
+	static constexpr int unbound = -1;
+	static constexpr int cube_a = max_buffers;		// for bind(), the cubemap
+
+	// the passes of shader, it has to stay loaded as long as this uses it; another shader takes another renderer
+	// cubemap_size: of the faces, if the shader has a cubemap pass
+	explicit multipass_renderer(const kernel::entry_points &shader, int cubemap_size = 512);
+
+	// buffer passes of the shader
+	int buffers() const { return Buffers; }
+
+	// what pass reads as iChannel<channel>: a buffer (0 for A, ...), cube_a or unbound
+	void bind(kernel::shader_pass pass, int channel, int buffer);
+
+	// or a texture, its levels have to stay where they are while bound
+	void bind(kernel::shader_pass pass, int channel, const kernel::channel &texture);
+
+	// a change of the output size starts the buffers over
+	void render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler);
+
+	// what render() does before the first frame: the cubemap pass if the shader has one, nothing after that
+	void bake(const uniforms &u, tile_scheduler &scheduler);
+
+	// the image pass alone, for a shader without buffers once baked: it changes nothing,
+	// so several frames can be shaded at the same time from different threads (see video.h)
+	void render_image(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler) const;
+
+	// back to all zero buffers and the cubemap baked again, the caller should restart iFrame along with it
+	void reset();
+
+	// as the last render() left it, float rgba, row 0 the top
+	framebuffer buffer(int index) const;
+
+	// nullptr if the shader has no cubemap pass
+	const baked_cubemap* cubemap() const { return Cube.get(); }
+
+private:
+	const kernel::entry_points *Shader;
+	int Buffers;
+	struct binding
+	{
+		int buffer;					// or unbound
+		kernel::channel texture;	// when not a buffer
+	};
+
+	binding Bindings[passes][kernel::max_channels];
+
+	std::unique_ptr<baked_cubemap> Cube;
+	bool Baked = false;
+
+	int Width = 0;
+	int Height = 0;
+	std::unique_ptr<image> Front[max_buffers];	// the last one written
+	std::unique_ptr<image> Back[max_buffers];	// written next
+
+	void channels_of(kernel::shader_pass pass, kernel::channel_level (&buffers)[kernel::max_channels],
+		kernel::channel (&channels)[kernel::max_channels]) const;
+	void shade_pass(const framebuffer &fb, const uniforms &u, tile_scheduler &scheduler, kernel::shader_pass pass) const;
+};
+
+} } // namespace vml::render
@@ -0,0 +1,163 @@
+#include "noise_volume.h"
+#include "../../vml/noise.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+namespace vml { namespace render {
+
+namespace {
+
+struct file_closer
+{
+	void operator()(FILE *f) const { fclose(f); }
+};
+using file_ptr = std::unique_ptr<FILE, file_closer>;
+
+// what a cache file starts with, the base level follows: rgba32f texels, x first then y then z
+struct cache_header
+{
+	char magic[4];
+	uint32_t version;
+	int32_t size;
+	int32_t cells;
+	int32_t octaves;
+	uint32_t seed;
+};
+
+constexpr char cache_magic[4] = { 'V', 'M', 'L', 'N' };
+constexpr uint32_t cache_version = 1;	// bump when what is baked changes
+
+std::string cache_path(const noise_options &o)
+{
+	const char *dir = getenv("VML_NOISE_CACHE");
+	char name[96];
+	snprintf(name, sizeof(name), "/vml_noise_%d_%d_%d_%u.bin", o.size, o.cells, o.octaves, o.seed);
+	return std::string(dir && *dir ? dir : "/tmp") + name;
+}
+
+} // anonymous namespace
+
+bool parse_noise(const char *spec, noise_options &options)
+{
+	if (strncmp(spec, "noise", 5) != 0 || (spec[5] != '\0' && spec[5] != ':')) {
+		return false;
+	}
+	if (spec[5] == ':') {
+		options.size = atoi(spec + 6);
+	}
+	return true;
+}
+
+noise_volume::noise_volume(const noise_options &options, tile_scheduler &scheduler, vml::sampler_state sampler)
+	: Options(options)
+	, Storage({ options.size, options.size, options.size }, vml::texel_format::rgba32f, nullptr)
+	, Sampler(sampler)
+	, Path(cache_path(options))
+{
+	for (int i = 0; i < Storage.levels(); ++i) {
+		const auto &level = Storage.level(i);
+		Levels[i] = { level.texels, { level.size[0], level.size[1], level.size[2] }, { level.pitch[0], level.pitch[1] },
+			static_cast<int>(level.layout), level.bits };
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	Cached = read(Path);
+	if (!Cached) {
+		bake(scheduler);
+		if (!write(Path)) {
+			Path.clear();
+		}
+	}
+	Storage.generate_mipmaps();
+	BakeTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+kernel::channel noise_volume::channel() const
+{
+	return { Levels, Storage.levels(), static_cast<int>(Sampler.filtering), static_cast<int>(Sampler.wrapping),
+		kernel::channel_type::texture_3d };
+}
+
+void noise_volume::bake(tile_scheduler &scheduler)
+{
+	const int n = Options.size;
+	const int cells = Options.cells;
+	const int octaves = Options.octaves;
+	const uint32_t seed = Options.seed;
+
+	// row z * n + y of the scheduler is the line of texels at that y and z
+	scheduler.run(n, n * n, [this, n, cells, octaves, seed](const tile &t)
+	{
+		const float scale = static_cast<float>(cells) / n;
+		for (int row = t.y_begin; row < t.y_end; ++row) {
+			const int y = row % n, z = row / n;
+			for (int x = t.x_begin; x < t.x_end; ++x) {
+				const vml::vector<float, 0, 1, 2> p((x + .5f) * scale, (y + .5f) * scale, (z + .5f) * scale);
+				float *texel = Storage.texel(x, y, z);
+				texel[0] = vml::noise::perlin_fbm(p, cells, octaves, seed);
+				texel[1] = vml::noise::worley_fbm(p, cells, 3, seed);
+				texel[2] = vml::noise::worley_fbm(p * 2.f, cells * 2, 3, seed);
+				texel[3] = vml::noise::worley_fbm(p * 4.f, cells * 4, 3, seed);
+			}
+		}
+	});
+}
+
+bool noise_volume::read(const std::string &path)
+{
+	file_ptr file(fopen(path.c_str(), "rb"));
+	if (!file) {
+		return false;
+	}
+
+	cache_header header;
+	if (fread(&header, sizeof(header), 1, file.get()) != 1 || memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+		|| header.version != cache_version || header.size != Options.size || header.cells != Options.cells
+		|| header.octaves != Options.octaves || header.seed != Options.seed) {
+		return false;
+	}
+
+	const int n = Options.size;
+	for (int z = 0; z < n; ++z) {
+		for (int y = 0; y < n; ++y) {
+			if (fread(Storage.texel(0, y, z), 4 * sizeof(float), n, file.get()) != static_cast<size_t>(n)) {
+				return false;	// truncated, baked again and overwritten
+			}
+		}
+	}
+	return true;
+}
+
+// into a file of its own then renamed over the cache, so another run reading it never sees half of it
+bool noise_volume::write(const std::string &path) const
+{
+	const std::string temp = path + "." + std::to_string(getpid());
+	file_ptr file(fopen(temp.c_str(), "wb"));
+	if (!file) {
+		return false;
+	}
+
+	cache_header header = { {}, cache_version, Options.size, Options.cells, Options.octaves, Options.seed };
+	memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	fwrite(&header, sizeof(header), 1, file.get());
+
+	const int n = Options.size;
+	for (int z = 0; z < n; ++z) {
+		for (int y = 0; y < n; ++y) {
+			fwrite(vml::detail::sampling::texel_at(Storage.level(0), 0, y, z), 4 * sizeof(float), n, file.get());
+		}
+	}
+
+	const bool ok = ferror(file.get()) == 0 && fclose(file.release()) == 0 && rename(temp.c_str(), path.c_str()) == 0;
+	if (!ok) {
+		remove(temp.c_str());
+	}
+	return ok;
+}
+
+} } // namespace vml::render
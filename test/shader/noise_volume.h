@@ -0,0 +1,71 @@
+#pragma once
+
+// Tileable noise volumes for iChannel0..3: what cloud shaders compute per raymarch step (octaves of 3D noise,
+// each a handful of hashes and lerps) baked once into a 3D texture, so a step costs one trilinear texture() instead
+// r: Perlin fbm, g, b, a: Worley fbm (inverted, billowy) at 1, 2 and 4 times the cells, see vml/noise.h
+// they all repeat across the volume, so it is read with wrap::repeat at any scale without a seam
+//
+// the volume is baked over all the cores by the tile scheduler (a row is a line of texels along x) and then kept
+// on disk, the next run with the same parameters only reads it back; the cache is the directory of the
+// VML_NOISE_CACHE environment variable, /tmp otherwise
+//
+// usage:
+//   noise_volume noise({ 128 }, scheduler);
+//   passes.bind(kernel::shader_pass::image, 0, noise.channel());
+//   // in the shader: float density = texture(iChannel0, p * 0.1).g;
+
+#include "render.h"
+#include "../../vml/sampler.h"
+
+#include <cstdint>
+#include <string>
+
+namespace vml { namespace render {
+
+struct noise_options
+{
+	int size = 64;			// texels on every axis
+	int cells = 4;			// noise cells across the volume, at the first octave
+	int octaves = 5;		// of the Perlin fbm, the Worley ones have 3
+	uint32_t seed = 0;
+};
+
+// "noise" or "noise:<size>" into options, false if it is neither (ex: a file name)
+bool parse_noise(const char *spec, noise_options &options);
+
+class noise_volume
+{
+public:
+	// bakes it or reads it from the cache, then makes the mips
+	noise_volume(const noise_options &options, tile_scheduler &scheduler,
+		vml::sampler_state sampler = { vml::filter::trilinear, vml::wrap::repeat });
+
+	int size() const { return Options.size; }
+
+	// stays valid for the lifetime of this
+	kernel::channel channel() const;
+
+	// read from the cache rather than baked
+	bool cached() const { return Cached; }
+
+	// ms it took to bake or read, mips included
+	float bake_time() const { return BakeTime; }
+
+	// the file of the cache, empty if a bake could not be written to it
+	const std::string& path() const { return Path; }
+
+private:
+	noise_options Options;
+	vml::texture_storage<3> Storage;
+	vml::sampler_state Sampler;
+	kernel::channel_level Levels[vml::max_texture_levels];
+	std::string Path;
+	bool Cached = false;
+	float BakeTime = 0;
+
+	void bake(tile_scheduler &scheduler);
+	bool read(const std::string &path);
+	bool write(const std::string &path) const;
+};
+
+} } // namespace vml::render
@@ -0,0 +1,114 @@
+#include "pipeline.h"
+
+#include <algorithm>
+
+namespace vml { namespace render {
+
+namespace {
+
+constexpr float smoothing = .1f;
+
+float milliseconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<float, std::milli>(d).count();
+}
+
+void smooth(float &average, float value)
+{
+	average = average == 0.f ? value : average + (value - average) * smoothing;
+}
+
+} // anonymous namespace
+
+frame_pipeline::frame_pipeline(int width, int height, format fmt, int depth, shade_func shade)
+	: Slots(std::max(depth, 1)), Shade(std::move(shade)), Start(steady::now())
+{
+	for (auto &s : Slots) {
+		s.pixels.reset(new image(width, height, fmt));
+		s.fb = s.pixels->view();
+	}
+	Thread = std::thread([this] { shading_loop(); });
+}
+
+frame_pipeline::~frame_pipeline()
+{
+	Stop.store(true);
+	// changing the word makes a wait_on() that is just about to sleep return instead, the ring is done with anyway
+	Tail.fetch_add(1);
+	wake_all(Tail);
+	Thread.join();
+}
+
+void frame_pipeline::update(const uniforms &u)
+{
+	std::lock_guard<std::mutex> lock(InputLock);
+	Input = u;
+}
+
+void frame_pipeline::shading_loop()
+{
+	const auto depth = static_cast<uint32_t>(Slots.size());
+	auto last = Start;
+	int frame = 0;
+
+	while (!Stop.load(std::memory_order_relaxed)) {
+		const uint32_t head = Head.load(std::memory_order_relaxed);
+		const uint32_t tail = Tail.load(std::memory_order_acquire);
+		if (head - tail >= depth) {
+			wait_on(Tail, tail);
+			continue;
+		}
+
+		auto &s = Slots[head % depth];
+		uniforms u;
+		{
+			std::lock_guard<std::mutex> lock(InputLock);
+			u = Input;
+		}
+		s.snapshot = steady::now();
+		u.time = milliseconds(s.snapshot - Start) / 1000;
+		u.time_delta = milliseconds(s.snapshot - last) / 1000;
+		u.frame = frame++;
+		last = s.snapshot;
+
+		Shade(s.fb, u);
+		s.shading = milliseconds(steady::now() - s.snapshot);
+
+		Head.store(head + 1, std::memory_order_release);
+		wake_all(Head);
+	}
+}
+
+const framebuffer* frame_pipeline::acquire(bool wait)
+{
+	const uint32_t tail = Tail.load(std::memory_order_relaxed);
+	for (;;) {
+		const uint32_t head = Head.load(std::memory_order_acquire);
+		if (head != tail) {
+			return &Slots[tail % Slots.size()].fb;
+		}
+		if (!wait) {
+			return nullptr;
+		}
+		wait_on(Head, head);
+	}
+}
+
+void frame_pipeline::release()
+{
+	const uint32_t tail = Tail.load(std::memory_order_relaxed);
+	const auto &s = Slots[tail % Slots.size()];
+
+	const auto now = steady::now();
+	if (LastRelease != steady::time_point()) {
+		smooth(Stats.throughput, 1000 / std::max(milliseconds(now - LastRelease), 1e-3f));
+	}
+	smooth(Stats.latency, milliseconds(now - s.snapshot));
+	smooth(Stats.shading, s.shading);
+	LastRelease = now;
+
+	Tail.store(tail + 1, std::memory_order_release);
+	wake_all(Tail);
+}
+
+} } // namespace vml::render
@@ -0,0 +1,91 @@
+#pragma once
+
+// Pipelined frames: a thread of its own shades the next frames while the caller presents the finished ones
+// the frames go around a lock free single producer / single consumer ring of depth images (2 double, 3 triple buffered),
+// the shading thread blocks when all of them are waiting to be presented and the presenting one when none is ready
+//
+// every frame gets a snapshot of the uniforms when it starts: iMouse and iDate as last given to update(),
+// iTime, iTimeDelta and iFrame from the pipeline's own clock so frames in flight don't share a time
+//
+// usage:
+//   frame_pipeline pipeline(w, h, format::rgb8, 3, [&](const framebuffer &fb, const uniforms &u) { shade(fb, u, scheduler); });
+//   for (;;) {
+//     pipeline.update(input);
+//     const framebuffer &fb = *pipeline.acquire();
+//     present(fb);
+//     pipeline.release();
+//   }
+
+#include "render.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vml { namespace render {
+
+// of the presented frames, moving averages
+struct pipeline_stats
+{
+	float throughput;	// frames per second
+	float latency;		// ms from the uniforms snapshot to release()
+	float shading;		// ms the shading thread spent on a frame
+};
+
+class frame_pipeline
+{
+public:
+	// called from the pipeline's thread, one frame at a time
+	using shade_func = std::function<void(const framebuffer &fb, const uniforms &u)>;
+
+	frame_pipeline(int width, int height, format fmt, int depth, shade_func shade);
+	~frame_pipeline();
+
+	frame_pipeline(const frame_pipeline &) = delete;
+	frame_pipeline& operator =(const frame_pipeline &) = delete;
+
+	// the frames not started yet get these (but their own time)
+	void update(const uniforms &u);
+
+	// the oldest shaded frame, nullptr if there is none and wait is false
+	// one at a time, it stays valid until release() hands it back for shading
+	const framebuffer* acquire(bool wait = true);
+	void release();
+
+	const pipeline_stats& stats() const { return Stats; }
+
+private:
+	using steady = std::chrono::steady_clock;
+
+	struct slot
+	{
+		std::unique_ptr<image> pixels;
+		framebuffer fb;
+		steady::time_point snapshot;
+		float shading;	// ms
+	};
+
+	std::vector<slot> Slots;
+	shade_func Shade;
+
+	std::mutex InputLock;
+	uniforms Input = {};
+
+	// frames [Tail, Head) are shaded and waiting, Head is only written by the shading thread and Tail by the presenting one
+	alignas(64) std::atomic<uint32_t> Head { 0 };
+	alignas(64) std::atomic<uint32_t> Tail { 0 };
+	std::atomic<bool> Stop { false };
+	std::thread Thread;
+
+	steady::time_point Start;
+	steady::time_point LastRelease;
+	pipeline_stats Stats = {};
+
+	void shading_loop();
+};
+
+} } // namespace vml::render
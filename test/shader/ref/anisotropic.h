@@ -10,7 +10,7 @@ float WardAnisotropy (in vec3 vNormal, in vec3 vDirection, in vec3 vEye, in vec3
     
     float B = 1.0+dot(A,vNormal);
     
-    float XY = -2.0*(pow(X,2.0)+pow(Y,2.0)) / B;
+    float XY = -2.0*(pow(X,LIT(2.0))+pow(Y,LIT(2.0))) / B;
     
     float C = exp(XY) * (1.0/12.5664*Roughness.x*Roughness.y);
     
@@ -23,7 +23,7 @@ float SampleDigit(const in float n, const in vec2 vUV)
 	vec2 vPixel = floor(vUV * vec2(4.0, 5.0));
 	float fIndex = vPixel.x + (vPixel.y * 4.0);
 	
-	return mod(vec2(floor(data / pow(2.0, fIndex))), 2.0).x;
+	return mod(vec2(floor(data / pow(LIT(2.0), fIndex))), LIT(2.0)).x;
 }
 
 float PrintInt(const in vec2 uv, const in float value )
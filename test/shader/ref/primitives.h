@@ -278,7 +278,7 @@ vec3 render( in vec3 ro, in vec3 rd )
         if( m<1.5 )
         {
             
-            float f = mod( floor(5.0*pos.z) + floor(5.0*pos.x), 2.0);
+            float f = mod( floor(5.0*pos.z) + floor(5.0*pos.x), LIT(2.0));
             col = 0.4 + 0.1*f*vec3(1.0);
         }
 
@@ -289,8 +289,8 @@ vec3 render( in vec3 ro, in vec3 rd )
         float dif = clamp( dot( nor, lig ), 0.0, 1.0 );
         float bac = clamp( dot( nor, normalize(vec3(-lig.x,0.0,-lig.z))), 0.0, 1.0 )*clamp( 1.0-pos.y,0.0,1.0);
         float dom = smoothstep( -0.1, 0.1, ref.y );
-        float fre = pow( clamp(1.0+dot(nor,rd),0.0,1.0), 2.0 );
-		float spe = pow(clamp( dot( ref, lig ), 0.0, 1.0 ),16.0);
+        float fre = pow( clamp(1.0+dot(nor,rd),0.0,1.0), LIT(2.0) );
+		float spe = pow(clamp( dot( ref, lig ), 0.0, 1.0 ),LIT(16.0));
         
         dif *= softshadow( pos, lig, 0.02, 2.5 );
         dom *= softshadow( pos, ref, 0.02, 2.5 );
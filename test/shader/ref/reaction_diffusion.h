@@ -0,0 +1,58 @@
+// Gray-Scott reaction diffusion, a multipass shader
+// Buffer A holds the two concentrations (u in x, v in y) and steps them once per frame from what it held the frame before
+// the image pass only colors them in; iMouse drops more of v where it is pressed
+
+#define SHADER_BUFFERS 1
+
+const float feed = 0.037;
+const float kill = 0.06;
+
+vec2 concentrations(vec2 p)
+{
+	return texelFetch(iChannel0, ivec2(p), 0).xy;
+}
+
+void mainBufferA(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 uv = fragCoord / iResolution.xy;
+
+	// seed a few blobs of v on the first frame
+	if (iFrame == 0) {
+		float seed = 0.0;
+		for (int i = 0; i < 5; i++) {
+			vec2 center = vec2(0.2 + 0.15 * float(i), 0.5 + 0.25 * sin(float(i) * 2.4));
+			seed += step(length((uv - center) * iResolution.xy), 6.0);
+		}
+		fragColor = vec4(1.0, min(seed, 1.0), 0.0, 1.0);
+		return;
+	}
+
+	vec2 c = concentrations(fragCoord);
+	vec2 laplacian = -c
+		+ 0.2 * (concentrations(fragCoord + vec2(1.0, 0.0)) + concentrations(fragCoord - vec2(1.0, 0.0))
+			+ concentrations(fragCoord + vec2(0.0, 1.0)) + concentrations(fragCoord - vec2(0.0, 1.0)))
+		+ 0.05 * (concentrations(fragCoord + vec2(1.0, 1.0)) + concentrations(fragCoord - vec2(1.0, 1.0))
+			+ concentrations(fragCoord + vec2(1.0, -1.0)) + concentrations(fragCoord - vec2(1.0, -1.0)));
+
+	float reaction = c.x * c.y * c.y;
+	vec2 next = c + vec2(
+		1.0 * laplacian.x - reaction + feed * (1.0 - c.x),
+		0.5 * laplacian.y + reaction - (kill + feed) * c.y);
+
+	if (iMouse.z > 0.0 && length(fragCoord - iMouse.xy) < 8.0) {
+		next.y = 1.0;
+	}
+
+	fragColor = vec4(clamp(next, 0.0, 1.0), 0.0, 1.0);
+}
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 uv = fragCoord / iResolution.xy;
+	float v = texture(iChannel0, uv).y;
+
+	vec3 col = mix(vec3(0.05, 0.08, 0.15), vec3(0.95, 0.75, 0.35), smoothstep(0.1, 0.4, v));
+	col = mix(col, vec3(1.0), smoothstep(0.4, 0.6, v));
+
+	fragColor = vec4(col, 1.0);
+}
@@ -0,0 +1,88 @@
+// Single scattering sky (Rayleigh and Mie), baked once into a cubemap
+// the integral along every view ray and towards the sun from every step of it is what atmosphere shaders
+// recompute per pixel per frame; here mainCubemap does it once per texel and mainImage only looks it up
+// the camera turns with iTime, the sky doesn't change
+
+#define SHADER_CUBEMAP
+
+const float earth_radius = 6360e3;
+const float atmosphere_radius = 6420e3;
+const float rayleigh_height = 7994.0;
+const float mie_height = 1200.0;
+const vec3 rayleigh_scattering = vec3(5.8e-6, 13.5e-6, 33.1e-6);
+const float mie_scattering = 21e-6;
+const float mie_g = 0.76;
+const vec3 sun_direction = vec3(0.0, 0.1, -0.995);
+const float sun_intensity = 20.0;
+
+// distance along the ray to where it leaves the sphere, from inside of it
+float exit_distance(vec3 origin, vec3 dir, float radius)
+{
+	float b = dot(origin, dir);
+	float c = dot(origin, origin) - radius * radius;
+	return -b + sqrt(max(b * b - c, 0.0));
+}
+
+// optical depth of both (x: Rayleigh, y: Mie) from p to the top of the atmosphere towards the sun
+vec2 sun_depth(vec3 p)
+{
+	const int steps = 8;
+	float step_length = exit_distance(p, sun_direction, atmosphere_radius) / float(steps);
+	vec2 depth = vec2(0.0);
+	for (int i = 0; i < steps; i++) {
+		vec3 q = p + sun_direction * (step_length * (float(i) + 0.5));
+		float height = length(q) - earth_radius;
+		depth += exp(-height / vec2(rayleigh_height, mie_height)) * step_length;
+	}
+	return depth;
+}
+
+vec3 sky(vec3 dir)
+{
+	const int steps = 16;
+	vec3 origin = vec3(0.0, earth_radius + 1.0, 0.0);
+	float step_length = exit_distance(origin, dir, atmosphere_radius) / float(steps);
+
+	vec3 rayleigh = vec3(0.0);
+	vec3 mie = vec3(0.0);
+	vec2 view_depth = vec2(0.0);
+	for (int i = 0; i < steps; i++) {
+		vec3 p = origin + dir * (step_length * (float(i) + 0.5));
+		float height = length(p) - earth_radius;
+		vec2 density = exp(-height / vec2(rayleigh_height, mie_height)) * step_length;
+		view_depth += density;
+
+		vec2 depth = view_depth + sun_depth(p);
+		vec3 attenuation = exp(-(rayleigh_scattering * depth.x + 1.1 * mie_scattering * depth.y));
+		rayleigh += attenuation * density.x;
+		mie += attenuation * density.y;
+	}
+
+	float mu = dot(dir, sun_direction);
+	float rayleigh_phase = 3.0 / (16.0 * 3.14159265) * (1.0 + mu * mu);
+	float g2 = mie_g * mie_g;
+	float mie_phase = 3.0 / (8.0 * 3.14159265) * ((1.0 - g2) * (1.0 + mu * mu))
+		/ ((2.0 + g2) * pow(1.0 + g2 - 2.0 * mie_g * mu, 1.5));
+	return sun_intensity * (rayleigh * rayleigh_scattering * rayleigh_phase + mie * mie_scattering * mie_phase);
+}
+
+void mainCubemap(out vec4 fragColor, in vec2 fragCoord, in vec3 rayOri, in vec3 rayDir)
+{
+	vec3 dir = normalize(rayDir);
+	// below the horizon is ground
+	fragColor = vec4(dir.y < 0.0 ? vec3(0.1, 0.09, 0.08) * max(sun_direction.y, 0.0) : sky(dir), 1.0);
+}
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 p = (2.0 * fragCoord - iResolution.xy) / iResolution.y;
+	float angle = 0.1 * iTime;
+	vec3 forward = vec3(sin(angle), 0.25, -cos(angle));
+	vec3 right = normalize(cross(forward, vec3(0.0, 1.0, 0.0)));
+	vec3 up = cross(right, forward);
+	vec3 dir = normalize(p.x * right + p.y * up + 1.5 * forward);
+
+	vec3 col = texture(iChannel0, dir).rgb;
+	col = 1.0 - exp(-col); // tone mapped
+	fragColor = vec4(pow(col, vec3(1.0 / 2.2)), 1.0);
+}
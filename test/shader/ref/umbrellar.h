@@ -69,7 +69,7 @@ void mainImage( out vec4 fragColor, in vec2 fragCoord )
     float t, r0, r1, r2, e, f;
     vec2 sinuv = vec2(uv.x, (sin(uv.x*40.0)*0.02 + 1.0)*uv.y);
     for (float i = 0.0; i < 10.0; i++) {
-    	t = mod(iTime + 0.3 * i, 3.0) * 0.2;
+    	t = mod(iTime + 0.3 * i, LIT(3.0)) * 0.2;
     	r0 = (t - 0.15) / 0.2 * 0.9 + 0.1;
     	r1 = (t - 0.15) / 0.2 * 0.1 + 0.9;
         r2 = (t - 0.15) / 0.2 * 0.15 + 0.85;
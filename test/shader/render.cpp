@@ -0,0 +1,184 @@
+#include "render.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <type_traits>
+
+namespace vml { namespace render {
+
+namespace {
+
+// pixel as float rgb whatever the format
+void load(const framebuffer &fb, int x, int y, float rgb[3])
+{
+	const auto row = reinterpret_cast<const uint8_t*>(fb.pixels) + y * fb.pitch;
+	if (fb.fmt == format::rgba32f) {
+		const auto src = reinterpret_cast<const float*>(row) + x * 4;
+		rgb[0] = src[0];
+		rgb[1] = src[1];
+		rgb[2] = src[2];
+	} else {
+		const auto src = row + x * bytes_per_pixel(fb.fmt);
+		rgb[0] = src[0] / 255.f;
+		rgb[1] = src[1] / 255.f;
+		rgb[2] = src[2] / 255.f;
+	}
+}
+
+// bilinear, pixel centers line up
+template<typename T, int channels>
+void upscale_rect(const framebuffer &src, const framebuffer &dst, const tile &t)
+{
+	const float sx = static_cast<float>(src.width) / dst.width;
+	const float sy = static_cast<float>(src.height) / dst.height;
+
+	for (int y = t.y_begin; y < t.y_end; ++y) {
+		const float v = std::max(0.f, (y + .5f) * sy - .5f);
+		const int y0 = std::min(static_cast<int>(v), src.height - 1);
+		const int y1 = std::min(y0 + 1, src.height - 1);
+		const float fy = v - y0;
+		const auto row0 = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src.pixels) + y0 * src.pitch);
+		const auto row1 = reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src.pixels) + y1 * src.pitch);
+		auto out = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(dst.pixels) + y * dst.pitch) + t.x_begin * channels;
+
+		for (int x = t.x_begin; x < t.x_end; ++x) {
+			const float u = std::max(0.f, (x + .5f) * sx - .5f);
+			const int x0 = std::min(static_cast<int>(u), src.width - 1);
+			const int x1 = std::min(x0 + 1, src.width - 1);
+			const float fx = u - x0;
+
+			for (int c = 0; c < channels; ++c) {
+				const float top = row0[x0 * channels + c] + (row0[x1 * channels + c] - row0[x0 * channels + c]) * fx;
+				const float bottom = row1[x0 * channels + c] + (row1[x1 * channels + c] - row1[x0 * channels + c]) * fx;
+				const float value = top + (bottom - top) * fy;
+				*out++ = std::is_integral<T>::value ? static_cast<T>(value + .5f) : static_cast<T>(value);
+			}
+		}
+	}
+}
+
+struct file_closer
+{
+	void operator()(FILE *f) const { fclose(f); }
+};
+using file_ptr = std::unique_ptr<FILE, file_closer>;
+
+void shade_frame(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::quad_pattern pattern, int phase, kernel::sample_pattern samples,
+	kernel::shader_pass pass = kernel::shader_pass::image, const kernel::channel *channels = nullptr)
+{
+	u.resolution[0] = static_cast<float>(fb.width);
+	u.resolution[1] = static_cast<float>(fb.height);
+	u.resolution[2] = 1.f;
+
+	scheduler.run(fb.width, fb.height, [&shader, &fb, &u, pattern, phase, samples, pass, channels](const tile &t)
+	{
+		shader.shade_rect({ &u, fb.pixels, fb.pitch, fb.fmt, fb.width, fb.height, t.x_begin, t.y_begin, t.x_end, t.y_end,
+			pattern, phase, 1, fb.height, samples, pass, channels });
+	});
+}
+
+} // anonymous namespace
+
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::quad_pattern pattern, int phase)
+{
+	shade_frame(shader, fb, u, scheduler, pattern, phase, kernel::sample_pattern::none);
+}
+
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::sample_pattern samples)
+{
+	shade_frame(shader, fb, u, scheduler, kernel::quad_pattern::all, 0, samples);
+}
+
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::shader_pass pass, const kernel::channel (&channels)[kernel::max_channels])
+{
+	shade_frame(shader, fb, u, scheduler, kernel::quad_pattern::all, 0, kernel::sample_pattern::none, pass, channels);
+}
+
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	const tile &rect)
+{
+	u.resolution[0] = static_cast<float>(fb.width);
+	u.resolution[1] = static_cast<float>(fb.height);
+	u.resolution[2] = 1.f;
+
+	const tile r = {
+		std::max(rect.x_begin, 0), std::max(rect.y_begin, 0), std::min(rect.x_end, fb.width), std::min(rect.y_end, fb.height)
+	};
+	if (r.x_begin >= r.x_end || r.y_begin >= r.y_end) {
+		return;
+	}
+	scheduler.run(r.x_end - r.x_begin, r.y_end - r.y_begin, [&shader, &fb, &u, &r](const tile &t)
+	{
+		shader.shade_rect({ &u, fb.pixels, fb.pitch, fb.fmt, fb.width, fb.height,
+			r.x_begin + t.x_begin, r.y_begin + t.y_begin, r.x_begin + t.x_end, r.y_begin + t.y_end,
+			kernel::quad_pattern::all, 0, 1, fb.height });
+	});
+}
+
+void upscale(const framebuffer &src, const framebuffer &dst, tile_scheduler &scheduler)
+{
+	scheduler.run(dst.width, dst.height, [&src, &dst](const tile &t)
+	{
+		switch (dst.fmt) {
+		case format::rgb8:
+			upscale_rect<uint8_t, 3>(src, dst, t);
+			break;
+		case format::rgba8:
+			upscale_rect<uint8_t, 4>(src, dst, t);
+			break;
+		case format::rgba32f:
+			upscale_rect<float, 4>(src, dst, t);
+			break;
+		}
+	});
+}
+
+// http://netpbm.sourceforge.net/doc/ppm.html
+bool write_ppm(const char *path, const framebuffer &fb)
+{
+	file_ptr file(fopen(path, "wb"));
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file.get(), "P6\n%d %d\n255\n", fb.width, fb.height);
+	std::vector<uint8_t> line(fb.width * 3);
+	for (int y = 0; y < fb.height; ++y) {
+		for (int x = 0; x < fb.width; ++x) {
+			float rgb[3];
+			load(fb, x, y, rgb);
+			for (int c = 0; c < 3; ++c) {
+				line[x * 3 + c] = static_cast<uint8_t>(255 * std::clamp(rgb[c], 0.f, 1.f) + 0.5f);
+			}
+		}
+		fwrite(line.data(), 1, line.size(), file.get());
+	}
+	return ferror(file.get()) == 0;
+}
+
+// http://www.pauldebevec.com/Research/HDR/PFM/
+// rows go bottom to top, the negative scale means little endian
+bool write_pfm(const char *path, const framebuffer &fb)
+{
+	file_ptr file(fopen(path, "wb"));
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file.get(), "PF\n%d %d\n-1.0\n", fb.width, fb.height);
+	std::vector<float> line(fb.width * 3);
+	for (int y = fb.height - 1; y >= 0; --y) {
+		for (int x = 0; x < fb.width; ++x) {
+			load(fb, x, y, &line[x * 3]);
+		}
+		fwrite(line.data(), sizeof(float), line.size(), file.get());
+	}
+	return ferror(file.get()) == 0;
+}
+
+} } // namespace vml::render
@@ -0,0 +1,92 @@
+#pragma once
+
+// Headless rendering of the sandboxed shader (kernel.cpp) - no window or display needed
+// the windowed apps are presenters on top of this
+//
+// usage:
+//   vml::render::image img(640, 360, vml::render::format::rgba32f);
+//   vml::render::uniforms u = {};
+//   u.time = 1.5f;
+//   vml::render::tile_scheduler scheduler;	// all the cores
+//   vml::render::shade(kernel::select(), img.view(), u, scheduler);
+//   vml::render::write_pfm("out.pfm", img.view());
+
+#include "kernel.h"
+#include "scheduler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vml { namespace render {
+
+using format = kernel::pixel_format;
+
+// resolution is filled in from the framebuffer
+using uniforms = kernel::uniforms;
+
+constexpr int bytes_per_pixel(format f)
+{
+	return f == format::rgb8 ? 3 : f == format::rgba8 ? 4 : 16;
+}
+
+// caller owned pixels, row 0 is the top
+struct framebuffer
+{
+	void *pixels;
+	int width;
+	int height;
+	int pitch;	// in bytes
+	format fmt;
+};
+
+// framebuffer that owns its pixels, rows are tightly packed
+class image
+{
+public:
+	image(int width, int height, format fmt)
+		: Width(width), Height(height), Fmt(fmt),
+		Pixels((static_cast<size_t>(width) * height * bytes_per_pixel(fmt) + sizeof(float) - 1) / sizeof(float))
+	{}
+
+	framebuffer view()
+	{
+		return { Pixels.data(), Width, Height, Width * bytes_per_pixel(Fmt), Fmt };
+	}
+
+private:
+	int Width;
+	int Height;
+	format Fmt;
+	std::vector<float> Pixels; // float so rgba32f is aligned
+};
+
+// the shader is any of the kernel (kernel::select() for the one in use, kernel::find() for another of the registry),
+// nothing here reads a global one so different shaders can render at the same time, each on a scheduler of its own
+
+// shades the whole framebuffer on the cores of the scheduler, optionally only some of the quads (see kernel::quad_pattern)
+// a scheduler runs one frame at a time: frames shaded in parallel need one each
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::quad_pattern pattern = kernel::quad_pattern::all, int phase = 0);
+
+// same, supersampled (see kernel::sample_pattern)
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::sample_pattern samples);
+
+// one pass of a multipass shader reading channels as iChannel0..3 (see multipass.h)
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	kernel::shader_pass pass, const kernel::channel (&channels)[kernel::max_channels]);
+
+// only the rect part of the framebuffer, the shader still sees the whole of it (iResolution, gl_FragCoord)
+void shade(const kernel::entry_points &shader, const framebuffer &fb, uniforms u, tile_scheduler &scheduler,
+	const tile &rect);
+
+// bilinear resize of src into dst, both in the same format and not overlapping
+void upscale(const framebuffer &src, const framebuffer &dst, tile_scheduler &scheduler);
+
+// PPM is 8-bit (floats get clamped), PFM is float (8-bit gets divided by 255)
+// alpha is dropped, return false if the file can't be written
+bool write_ppm(const char *path, const framebuffer &fb);
+bool write_pfm(const char *path, const framebuffer &fb);
+
+} } // namespace vml::render
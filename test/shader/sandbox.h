@@ -1,9 +1,17 @@
 #include "../../vml/vector.h"
 #include "../../vml/matrix.h"
+#include "../../vml/rng.h"
+#include "../../vml/sampler.h"
 
 using  vec4 = vml::vector<float, 0, 1, 2, 3>;
 using  vec3 = vml::vector<float, 0, 1, 2>;
 using  vec2 = vml::vector<float, 0, 1>;
+using ivec4 = vml::vector<int, 0, 1, 2, 3>;
+using ivec3 = vml::vector<int, 0, 1, 2>;
+using ivec2 = vml::vector<int, 0, 1>;
+using sampler2D = vml::sampler2D;	// texture(), texelFetch(), ... are found next to it
+using sampler3D = vml::sampler3D;
+using samplerCube = vml::samplerCube;
 using   _01 = vml::indices_pack<0, 1>;
 using  _012 = vml::indices_pack<0, 1, 2>;
 using _0123 = vml::indices_pack<0, 1, 2, 3>;
@@ -30,25 +38,115 @@ struct fragment_shader
 	vec2 gl_FragCoord;
 	vec4 gl_FragColor;
 	void main(vec4 &fragColor, vec2 fragCoord); // Shadertoy.com
+	void buffer_a(vec4 &fragColor, vec2 fragCoord); // the passes of a multipass shader, see SHADER_BUFFERS
+	void buffer_b(vec4 &fragColor, vec2 fragCoord);
+	void buffer_c(vec4 &fragColor, vec2 fragCoord);
+	void buffer_d(vec4 &fragColor, vec2 fragCoord);
+	void cubemap(vec4 &fragColor, vec2 fragCoord, vec3 rayOri, vec3 rayDir); // Cube A, see SHADER_CUBEMAP
 };
 
+// what iChannel0..3 are: a 2D texture, a 3D one or a cubemap, whichever is bound (see kernel::channel_type)
+// vec2 coordinates read the 2D one, vec3 ones the cubemap (a direction) or else the 3D one, what isn't bound reads as 0
+struct channel_sampler
+{
+	sampler2D flat;
+	sampler3D volume;
+	samplerCube cube;
+};
+
+inline vec4 texture(const channel_sampler &c, vec2 uv, float bias = 0.0f) { return vml::texture(c.flat, uv, bias); }
+inline vec4 texture(const channel_sampler &c, vec3 p, float bias = 0.0f)
+{
+	return c.cube.bound() ? vml::texture(c.cube, p, bias) : vml::texture(c.volume, p, bias);
+}
+inline vec4 textureLod(const channel_sampler &c, vec2 uv, float lod) { return vml::textureLod(c.flat, uv, lod); }
+inline vec4 textureLod(const channel_sampler &c, vec3 p, float lod)
+{
+	return c.cube.bound() ? vml::textureLod(c.cube, p, lod) : vml::textureLod(c.volume, p, lod);
+}
+inline vec4 texelFetch(const channel_sampler &c, ivec2 xy, int lod) { return vml::texelFetch(c.flat, xy, lod); }
+inline vec4 texelFetch(const channel_sampler &c, ivec3 xyz, int lod) { return vml::texelFetch(c.volume, xyz, lod); }
+inline ivec2 textureSize(const channel_sampler &c, int lod) // of a 3D texture the width and height, its depth is iChannelResolution[n].z
+{
+	if (c.volume.bound()) {
+		const ivec3 size = vml::textureSize(c.volume, lod);
+		return ivec2(size.x, size.y);
+	}
+	return c.cube.bound() ? vml::textureSize(c.cube, lod) : vml::textureSize(c.flat, lod);
+}
+inline int textureQueryLevels(const channel_sampler &c)
+{
+	return c.cube.bound() ? vml::textureQueryLevels(c.cube) : c.volume.bound() ? vml::textureQueryLevels(c.volume)
+		: vml::textureQueryLevels(c.flat);
+}
+
+// opt-in compile time literals: LIT(2.0) becomes vml::c<2> so builtins can strength reduce it
+// ex: pow(x, LIT(5.0)) is unrolled into multiplies, x / LIT(3.0) multiplies by the reciprocal
+#ifdef VML_CONSTANT_LITERALS
+using namespace ::vml::literals;
+#define LIT(x) x##_c
+#else
+#define LIT(x) x
+#endif
+
 #define in
 #define out funccall_inout::
 #define inout funccall_inout::
 #define uniform extern
 
-// verbatim from Shadertoy.com
-uniform vec3      iResolution;           // viewport resolution (in pixels)
-uniform float     iTime;                 // shader playback time (in seconds)
-uniform float     iTimeDelta;            // render time (in seconds)
-uniform int       iFrame;                // shader playback frame
-uniform float     iChannelTime[4];       // channel playback time (in seconds)
-uniform vec3      iChannelResolution[4]; // channel resolution (in pixels)
-uniform vec4      iMouse;                // mouse pixel coords. xy: current (if MLB down), zw: click
-uniform vec4      iDate;                 // (year, month, day, time in seconds)
-uniform float     iSampleRate;           // sound sample rate (i.e., 44100)
-float &			  iGlobalTime = iTime;	 // old name
+// the uniforms are per invocation, not globals: the kernel points current_uniforms at the ones of the job
+// it is shading (see kernel.cpp) and the Shadertoy names below read from there, so any number of frames
+// or shader instances can be shaded at the same time on different threads
+struct uniform_context
+{
+	// verbatim from Shadertoy.com
+	vec3      iResolution;           // viewport resolution (in pixels)
+	float     iTime;                 // shader playback time (in seconds)
+	float     iTimeDelta;            // render time (in seconds)
+	int       iFrame;                // shader playback frame
+	float     iChannelTime[4];       // channel playback time (in seconds)
+	vec3      iChannelResolution[4]; // channel resolution (in pixels)
+	vec4      iMouse;                // mouse pixel coords. xy: current (if MLB down), zw: click
+	vec4      iDate;                 // (year, month, day, time in seconds)
+	float     iSampleRate;           // sound sample rate (i.e., 44100)
+	channel_sampler iChannel0;       // input channels: textures, the buffers of a multipass shader, cubemaps
+	channel_sampler iChannel1;
+	channel_sampler iChannel2;
+	channel_sampler iChannel3;
+};
+
+inline thread_local const uniform_context *current_uniforms = nullptr;
+
+#define iResolution			(current_uniforms->iResolution)
+#define iTime				(current_uniforms->iTime)
+#define iTimeDelta			(current_uniforms->iTimeDelta)
+#define iFrame				(current_uniforms->iFrame)
+#define iChannelTime		(current_uniforms->iChannelTime)
+#define iChannelResolution	(current_uniforms->iChannelResolution)
+#define iMouse				(current_uniforms->iMouse)
+#define iDate				(current_uniforms->iDate)
+#define iSampleRate			(current_uniforms->iSampleRate)
+#define iChannel0			(current_uniforms->iChannel0)
+#define iChannel1			(current_uniforms->iChannel1)
+#define iChannel2			(current_uniforms->iChannel2)
+#define iChannel3			(current_uniforms->iChannel3)
+#define iGlobalTime			iTime // old name
 #define mainImage fragment_shader::main
+#define mainBufferA fragment_shader::buffer_a
+#define mainBufferB fragment_shader::buffer_b
+#define mainBufferC fragment_shader::buffer_c
+#define mainBufferD fragment_shader::buffer_d
+#define mainCubemap fragment_shader::cubemap
+
+// a shader can declare what its picture depends on so unchanged frames don't get shaded again
+// (see kernel::shader_traits), by #define'ing before its mainImage:
+// SHADER_TIME_INVARIANT - iTime, iTimeDelta, iFrame and iDate don't change the picture
+// SHADER_MOUSE_RADIUS - iMouse only changes the pixels within that many pixels of iMouse.xy and iMouse.zw
+//
+// a multipass shader #define's SHADER_BUFFERS (1 to 4) and has a mainBufferA (B, C, D) for each one next to its mainImage,
+// they run in that order every frame into float buffers the passes read as iChannel0..3 (see multipass.h)
+// SHADER_CUBEMAP declares a mainCubemap (Shadertoy's Cube A), shaded once into the six faces of a cubemap
+// the passes then read as samplerCube through iChannel0..3: a sky computed once and only looked up after
 
 /***** SHADERBOX *************************************************************/
 #if defined(APP_EGG)
@@ -70,6 +168,18 @@ float &			  iGlobalTime = iTime;	 // old name
 #include <app_func.h>
 #elif defined(APP_VINYL)
 #include <app_vinyl.h>
+#elif defined(REF_UMBRELLAR)
+#include "ref/umbrellar.h"
+#elif defined(REF_ANISOTROPIC)
+#include "ref/anisotropic.h"
+#elif defined(REF_PRIMITIVES)
+#include "ref/primitives.h"
+#elif defined(REF_REACTION_DIFFUSION)
+#include "ref/reaction_diffusion.h"
+#elif defined(REF_SKY)
+#include "ref/sky.h"
+#elif defined(SHADER_HEADER)
+#include SHADER_HEADER	// a quoted path, hot reloaded shaders (see hot_reload.h)
 #else
 #include "ref/default.h"
 #endif
@@ -89,7 +199,28 @@ float &			  iGlobalTime = iTime;	 // old name
 /*****************************************************************************/
 
 #undef mainImage
+#undef mainBufferA
+#undef mainBufferB
+#undef mainBufferC
+#undef mainBufferD
+#undef mainCubemap
+
+#undef iResolution
+#undef iTime
+#undef iTimeDelta
+#undef iFrame
+#undef iChannelTime
+#undef iChannelResolution
+#undef iMouse
+#undef iDate
+#undef iSampleRate
+#undef iChannel0
+#undef iChannel1
+#undef iChannel2
+#undef iChannel3
+#undef iGlobalTime
 
+#undef LIT
 #undef in
 #undef out
 #undef inout
@@ -0,0 +1,112 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace vml { namespace render {
+
+namespace {
+
+constexpr uint64_t pack(uint32_t front, uint32_t back)
+{
+	return (static_cast<uint64_t>(back) << 32) | front;
+}
+
+constexpr uint32_t front_of(uint64_t bounds)
+{
+	return static_cast<uint32_t>(bounds);
+}
+
+constexpr uint32_t back_of(uint64_t bounds)
+{
+	return static_cast<uint32_t>(bounds >> 32);
+}
+
+} // anonymous namespace
+
+tile_scheduler::tile_scheduler(int threads, int tile_width, int tile_height, bool pin)
+	: Pool(threads, pin),
+	Threads(Pool.threads()),
+	TileWidth(std::max(1, tile_width)),
+	TileHeight(std::max(1, tile_height)),
+	Ranges(new run_range[Threads])
+{
+}
+
+void tile_scheduler::run(int width, int height, const std::function<void(const tile &)> &func)
+{
+	const int tiles_x = (width + TileWidth - 1) / TileWidth;
+	const int tiles_y = (height + TileHeight - 1) / TileHeight;
+	const auto count = static_cast<int64_t>(tiles_x) * tiles_y;
+
+	// row major runs, worker i starts at the i-th slab of the frame
+	for (int i = 0; i < Threads; ++i) {
+		Ranges[i].bounds.store(pack(static_cast<uint32_t>(count * i / Threads),
+			static_cast<uint32_t>(count * (i + 1) / Threads)), std::memory_order_relaxed);
+	}
+
+	std::vector<int> steals(Threads, 0);
+	Pool.run([&](int worker) { work(worker, tiles_x, width, height, func, steals[worker]); });
+
+	Steals = 0;
+	for (auto s : steals) {
+		Steals += s;
+	}
+}
+
+void tile_scheduler::work(int self, int tiles_x, int width, int height, const std::function<void(const tile &)> &func, int &steals)
+{
+	for (;;) {
+		for (int i = pop(self); i >= 0; i = pop(self)) {
+			const int x = i % tiles_x * TileWidth;
+			const int y = i / tiles_x * TileHeight;
+			func(tile{ x, y, std::min(x + TileWidth, width), std::min(y + TileHeight, height) });
+		}
+
+		const int stolen = steal(self);
+		if (stolen == 0) {
+			return;
+		}
+		steals += stolen;
+	}
+}
+
+int tile_scheduler::pop(int self)
+{
+	auto &bounds = Ranges[self].bounds;
+	auto current = bounds.load(std::memory_order_acquire);
+	for (;;) {
+		const auto front = front_of(current), back = back_of(current);
+		if (front >= back) {
+			return -1;
+		}
+		if (bounds.compare_exchange_weak(current, pack(front + 1, back), std::memory_order_acq_rel)) {
+			return static_cast<int>(front);
+		}
+	}
+}
+
+// takes half of the first non empty run after ours and makes it ours
+// nobody can steal from an empty run so overwriting our own bounds is safe
+// a run seen empty while its thief hasn't published it yet is fine: the thief will shade it
+int tile_scheduler::steal(int self)
+{
+	for (int n = 1; n < Threads; ++n) {
+		auto &victim = Ranges[(self + n) % Threads].bounds;
+		auto current = victim.load(std::memory_order_acquire);
+		for (;;) {
+			const auto front = front_of(current), back = back_of(current);
+			if (front >= back) {
+				break;
+			}
+			const auto take = (back - front + 1) / 2;
+			if (victim.compare_exchange_weak(current, pack(front, back - take), std::memory_order_acq_rel)) {
+				Ranges[self].bounds.store(pack(back - take, back), std::memory_order_release);
+				return static_cast<int>(take);
+			}
+		}
+	}
+	return 0;
+}
+
+} } // namespace vml::render
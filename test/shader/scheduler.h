@@ -0,0 +1,63 @@
+#pragma once
+
+// Tile based work stealing for shading a frame
+// the frame is cut into small tiles (32x8 by default) and every worker starts on its own contiguous run of them,
+// so neighbouring tiles stay on the same core; when a worker runs out it steals half of what is left of somebody else's run
+// expensive regions (ex: sky vs ground in a raymarcher) end up spread over all the cores
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace vml { namespace render {
+
+struct tile
+{
+	int x_begin;
+	int y_begin;
+	int x_end;
+	int y_end;
+};
+
+class tile_scheduler
+{
+public:
+	// threads <= 0 is all the cores
+	explicit tile_scheduler(int threads = 0, int tile_width = 32, int tile_height = 8, bool pin = true);
+
+	int threads() const { return Pool.threads(); }
+
+	// calls func once for every tile of the width x height frame, from all the workers (the calling thread is one of them)
+	// returns when the whole frame is done
+	void run(int width, int height, const std::function<void(const tile &)> &func);
+
+	// tiles that changed worker during the last run
+	int steals() const { return Steals; }
+
+	// cost of handing the last run to the workers and getting it back
+	const dispatch_stats& dispatch() const { return Pool.stats(); }
+
+private:
+	// [front, back) of tile indices packed in one word so popping and stealing are a single CAS
+	// the owner takes from the front, thieves from the back
+	struct alignas(64) run_range
+	{
+		std::atomic<uint64_t> bounds;
+	};
+
+	thread_pool Pool;
+	int Threads;
+	int TileWidth;
+	int TileHeight;
+	int Steals = 0;
+	std::unique_ptr<run_range[]> Ranges;
+
+	void work(int self, int tiles_x, int width, int height, const std::function<void(const tile &)> &func, int &steals);
+	int pop(int self);
+	int steal(int self);
+};
+
+} } // namespace vml::render
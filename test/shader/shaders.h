@@ -0,0 +1,13 @@
+#pragma once
+
+// The shaders built into the registry (see kernel::find), name and the #define that picks it in sandbox.h
+// every one is compiled once per instruction set into its own namespaces, CMakeLists.txt has the same list
+// the APP_??? shaders live outside of this repository, builds that have them pick one with the #define (Makefile)
+
+#define KERNEL_SHADERS(X) \
+	X(default, REF_DEFAULT) \
+	X(umbrellar, REF_UMBRELLAR) \
+	X(anisotropic, REF_ANISOTROPIC) \
+	X(primitives, REF_PRIMITIVES) \
+	X(reaction_diffusion, REF_REACTION_DIFFUSION) \
+	X(sky, REF_SKY)
@@ -0,0 +1,126 @@
+#include "supersampling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace vml { namespace render {
+
+namespace {
+
+// pixel as float rgb whatever the format
+void load(const framebuffer &fb, int x, int y, float rgb[3])
+{
+	const auto row = reinterpret_cast<const uint8_t*>(fb.pixels) + y * fb.pitch;
+	if (fb.fmt == format::rgba32f) {
+		const auto src = reinterpret_cast<const float*>(row) + x * 4;
+		rgb[0] = src[0];
+		rgb[1] = src[1];
+		rgb[2] = src[2];
+	} else {
+		const auto src = row + x * bytes_per_pixel(fb.fmt);
+		rgb[0] = src[0] / 255.f;
+		rgb[1] = src[1] / 255.f;
+		rgb[2] = src[2] / 255.f;
+	}
+}
+
+} // anonymous namespace
+
+supersampler::pattern supersampler::named(const char *name)
+{
+	return strcmp(name, "rgss") == 0 ? pattern::rotated_grid
+		: strcmp(name, "rooks") == 0 ? pattern::rooks
+		: strcmp(name, "stratified") == 0 ? pattern::stratified
+		: pattern::none;
+}
+
+supersampler::supersampler(const kernel::entry_points &shader, pattern p, float edge_threshold)
+	: Shader(&shader), Pattern(p), EdgeThreshold(edge_threshold)
+{
+}
+
+void supersampler::render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler)
+{
+	const int samples = kernel::offsets(Pattern).count;
+	if (!(EdgeThreshold > 0.f)) {
+		shade(*Shader, out, u, scheduler, Pattern);
+		Shaded = static_cast<float>(samples);
+		Supersampled = 1;
+		return;
+	}
+
+	shade(*Shader, out, u, scheduler);
+
+	// the tiles are in quads, the edges are found before any of them gets shaded again
+	const int quads_x = (out.width + 1) / 2;
+	const int quads_y = (out.height + 1) / 2;
+	Edges.resize(static_cast<size_t>(quads_x) * quads_y);
+
+	const float threshold = EdgeThreshold;
+	std::atomic<int> edge_pixels { 0 };
+	scheduler.run(quads_x, quads_y, [&](const tile &t)
+	{
+		int count = 0;
+		for (int qy = t.y_begin; qy < t.y_end; ++qy) {
+			for (int qx = t.x_begin; qx < t.x_end; ++qx) {
+				const int x_end = std::min(qx * 2 + 2, out.width);
+				const int y_end = std::min(qy * 2 + 2, out.height);
+
+				bool edge = false;
+				for (int y = qy * 2; y < y_end && !edge; ++y) {
+					for (int x = qx * 2; x < x_end && !edge; ++x) {
+						float center[3], neighbour[3];
+						load(out, x, y, center);
+						const int around[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+						for (const auto &n : around) {
+							if (n[0] < 0 || n[0] >= out.width || n[1] < 0 || n[1] >= out.height) {
+								continue;
+							}
+							load(out, n[0], n[1], neighbour);
+							for (int c = 0; c < 3; ++c) {
+								edge |= !(std::abs(center[c] - neighbour[c]) <= threshold);
+							}
+						}
+					}
+				}
+
+				Edges[qy * quads_x + qx] = edge;
+				count += edge ? (x_end - qx * 2) * (y_end - qy * 2) : 0;
+			}
+		}
+		edge_pixels += count;
+	});
+
+	// edge quads next to each other are shaded together
+	const auto &kernel = *Shader;
+	uniforms full = u;
+	full.resolution[0] = static_cast<float>(out.width);
+	full.resolution[1] = static_cast<float>(out.height);
+	full.resolution[2] = 1.f;
+	const auto samples_pattern = Pattern;
+	scheduler.run(quads_x, quads_y, [&](const tile &t)
+	{
+		for (int qy = t.y_begin; qy < t.y_end; ++qy) {
+			for (int qx = t.x_begin; qx < t.x_end; ++qx) {
+				if (!Edges[qy * quads_x + qx]) {
+					continue;
+				}
+				const int run = qx;
+				while (qx + 1 < t.x_end && Edges[qy * quads_x + qx + 1]) {
+					++qx;
+				}
+				kernel.shade_rect({ &full, out.pixels, out.pitch, out.fmt, out.width, out.height,
+					run * 2, qy * 2, std::min(qx * 2 + 2, out.width), std::min(qy * 2 + 2, out.height),
+					kernel::quad_pattern::all, 0, 1, out.height, samples_pattern });
+			}
+		}
+	});
+
+	const float pixels = static_cast<float>(out.width) * out.height;
+	Supersampled = edge_pixels / pixels;
+	Shaded = 1 + Supersampled * samples;
+}
+
+} } // namespace vml::render
@@ -0,0 +1,52 @@
+#pragma once
+
+// Supersampling antialiasing: main() runs several times per pixel at the offsets of a sample pattern
+// and the kernel averages them before storing, so there is never a high resolution buffer
+//
+// with an edge threshold the frame is shaded once per pixel first and only the quads that have a pixel
+// differing from one of its 4 neighbours by more than the threshold (in any channel, 0..1 colors)
+// get shaded again with the whole pattern, the usual place for aliasing being the edges;
+// aliasing inside of flat looking areas (thin lines, moire) is only caught with no threshold
+//
+// usage:
+//   supersampler ssaa(kernel::select(), supersampler::pattern::rotated_grid, 1.f / 16);
+//   ssaa.render(out, u, scheduler);
+
+#include "render.h"
+
+#include <vector>
+
+namespace vml { namespace render {
+
+class supersampler
+{
+public:
+	using pattern = kernel::sample_pattern;
+
+	// rgss, rooks or stratified, none for anything else
+	static pattern named(const char *name);
+
+	// edge_threshold: 0 supersamples every pixel
+	explicit supersampler(const kernel::entry_points &shader, pattern p = pattern::rotated_grid, float edge_threshold = 0);
+
+	// what render() shades from now on, it has to stay loaded as long as this uses it
+	void shader(const kernel::entry_points &s) { Shader = &s; }
+
+	void render(const framebuffer &out, const uniforms &u, tile_scheduler &scheduler);
+
+	// of the last frame, main() calls per pixel of out and the fraction of the pixels that were supersampled
+	float shaded() const { return Shaded; }
+	float supersampled() const { return Supersampled; }
+
+private:
+	const kernel::entry_points *Shader;
+	pattern Pattern;
+	float EdgeThreshold;
+
+	std::vector<char> Edges;	// per quad
+
+	float Shaded = 0;
+	float Supersampled = 0;
+};
+
+} } // namespace vml::render
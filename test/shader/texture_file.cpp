@@ -0,0 +1,654 @@
+#include "texture_file.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TEXTURE_FILE_MMAP
+#endif
+
+namespace vml { namespace render {
+
+using steady = std::chrono::steady_clock;
+
+namespace {
+
+float milliseconds(steady::duration d)
+{
+	return std::chrono::duration<float, std::milli>(d).count();
+}
+
+// larger sizes in a header are taken for a broken file
+constexpr int max_size = 1 << 15;
+
+bool valid_size(int width, int height)
+{
+	return width > 0 && height > 0 && width <= max_size && height <= max_size;
+}
+
+// the bytes of the mapping, nothing is read past the end
+struct reader
+{
+	const uint8_t *data;
+	size_t size;
+	size_t at;
+
+	bool left(size_t n) const { return at <= size && size - at >= n; }
+
+	uint8_t byte() { return at < size ? data[at++] : 0; }
+
+	uint32_t big_endian32()
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; ++i) {
+			value = value << 8 | byte();
+		}
+		return value;
+	}
+
+	uint16_t little_endian16()
+	{
+		const uint16_t low = byte();
+		return static_cast<uint16_t>(low | byte() << 8);
+	}
+
+	// the next token of a Netpbm header, comments skipped
+	bool token(char *out, size_t length)
+	{
+		for (;;) {
+			while (at < size && isspace(data[at])) {
+				++at;
+			}
+			if (at < size && data[at] == '#') {
+				while (at < size && data[at] != '\n') {
+					++at;
+				}
+			} else {
+				break;
+			}
+		}
+		size_t n = 0;
+		while (at < size && !isspace(data[at]) && n + 1 < length) {
+			out[n++] = static_cast<char>(data[at++]);
+		}
+		out[n] = 0;
+		return n > 0;
+	}
+
+	int number()
+	{
+		char text[16];
+		return token(text, sizeof(text)) && isdigit(static_cast<unsigned char>(text[0])) ? atoi(text) : -1;
+	}
+};
+
+bool little_endian()
+{
+	const uint16_t one = 1;
+	uint8_t first;
+	memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+int channels_of(texel_format format)
+{
+	return format == texel_format::r8 || format == texel_format::r32f ? 1
+		: format == texel_format::rgb8 || format == texel_format::rgb32f ? 3 : 4;
+}
+
+bool is_float(texel_format format)
+{
+	return format == texel_format::r32f || format == texel_format::rgb32f || format == texel_format::rgba32f;
+}
+
+// grey, rgb or rgba into rgba, like texture_storage does
+void expand(float *texel, int channels)
+{
+	if (channels == 1) {
+		texel[1] = texel[2] = texel[0];
+	}
+	if (channels < 4) {
+		texel[3] = 1.f;
+	}
+}
+
+// P5 (grey) and P6 (rgb), 8 or 16 bits big endian, the top row first
+template<typename Make>
+const char* decode_ppm(reader in, Make make)
+{
+	const int channels = in.data[1] == '6' ? 3 : 1;
+	in.at = 2;
+	const int width = in.number(), height = in.number(), maxval = in.number();
+	if (!valid_size(width, height) || maxval <= 0 || maxval > 65535) {
+		return "bad PPM header";
+	}
+	in.byte();	// the one whitespace before the texels
+
+	const int bytes = maxval > 255 ? 2 : 1;
+	if (!in.left(static_cast<size_t>(width) * height * channels * bytes)) {
+		return "truncated PPM";
+	}
+
+	auto &tex = make(width, height);
+	const float scale = 1.f / maxval;
+	const uint8_t *p = in.data + in.at;
+	for (int y = height - 1; y >= 0; --y) {
+		for (int x = 0; x < width; ++x) {
+			float *texel = tex.texel(x, y);
+			for (int c = 0; c < channels; ++c, p += bytes) {
+				texel[c] = (bytes == 1 ? p[0] : p[0] << 8 | p[1]) * scale;
+			}
+			expand(texel, channels);
+		}
+	}
+	return nullptr;
+}
+
+// PF (rgb) and Pf (grey), floats of the endianness of the scale's sign, the bottom row first
+template<typename Make>
+const char* decode_pfm(reader in, Make make)
+{
+	const int channels = in.data[1] == 'F' ? 3 : 1;
+	in.at = 2;
+	const int width = in.number(), height = in.number();
+	char scale[32];
+	if (!valid_size(width, height) || !in.token(scale, sizeof(scale))) {
+		return "bad PFM header";
+	}
+	in.byte();
+
+	const size_t floats = static_cast<size_t>(width) * height * channels;
+	if (!in.left(floats * sizeof(float))) {
+		return "truncated PFM";
+	}
+
+	auto &tex = make(width, height);
+	const bool swap = (atof(scale) < 0) != little_endian();
+	const uint8_t *p = in.data + in.at;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			float *texel = tex.texel(x, y);
+			for (int c = 0; c < channels; ++c, p += sizeof(float)) {
+				uint8_t bytes[sizeof(float)];
+				for (size_t i = 0; i < sizeof(float); ++i) {
+					bytes[i] = p[swap ? sizeof(float) - 1 - i : i];
+				}
+				memcpy(&texel[c], bytes, sizeof(float));
+			}
+			expand(texel, channels);
+		}
+	}
+	return nullptr;
+}
+
+// types 2 and 10 (BGR and BGRA, RLE for 10), 3 and 11 (grey), the bottom row first unless bit 5 of the descriptor
+template<typename Make>
+const char* decode_tga(reader in, Make make)
+{
+	if (!in.left(18)) {
+		return "truncated TGA";
+	}
+	const uint8_t *header = in.data;
+	const int type = header[2], bpp = header[16], descriptor = header[17];
+	const bool rle = type == 10 || type == 11;
+	const bool grey = type == 3 || type == 11;
+	if (header[1] != 0 || !(type == 2 || type == 3 || type == 10 || type == 11)
+		|| (grey ? bpp != 8 : bpp != 24 && bpp != 32)) {
+		return "unsupported TGA, only true color and grey ones with 8, 24 or 32 bits per pixel";
+	}
+	in.at = 12;
+	const int width = in.little_endian16(), height = in.little_endian16();
+	if (!valid_size(width, height)) {
+		return "bad TGA header";
+	}
+	in.at = 18 + header[0];	// after the image id
+
+	auto &tex = make(width, height);
+	const bool top_down = (descriptor & 0x20) != 0, right_to_left = (descriptor & 0x10) != 0;
+	const int bytes = bpp / 8;
+	const size_t count = static_cast<size_t>(width) * height;
+	auto put = [&](size_t i, const uint8_t *px) {
+		const int row = static_cast<int>(i / width), column = static_cast<int>(i % width);
+		float *texel = tex.texel(right_to_left ? width - 1 - column : column, top_down ? height - 1 - row : row);
+		if (bytes == 1) {
+			texel[0] = px[0] / 255.f;
+		} else {
+			texel[0] = px[2] / 255.f;
+			texel[1] = px[1] / 255.f;
+			texel[2] = px[0] / 255.f;
+			if (bytes == 4) {
+				texel[3] = px[3] / 255.f;
+			}
+		}
+		expand(texel, bytes);
+	};
+
+	if (!rle) {
+		if (!in.left(count * bytes)) {
+			return "truncated TGA";
+		}
+		for (size_t i = 0; i < count; ++i) {
+			put(i, in.data + in.at + i * bytes);
+		}
+		return nullptr;
+	}
+
+	for (size_t i = 0; i < count;) {
+		const uint8_t packet = in.byte();
+		const size_t run = (packet & 0x7f) + 1u < count - i ? (packet & 0x7f) + 1u : count - i;
+		const bool repeated = (packet & 0x80) != 0;
+		if (!in.left(repeated ? bytes : run * bytes)) {
+			return "truncated TGA";
+		}
+		for (size_t n = 0; n < run; ++n) {
+			put(i + n, in.data + in.at + (repeated ? 0 : n * bytes));
+		}
+		in.at += repeated ? bytes : run * bytes;
+		i += run;
+	}
+	return nullptr;
+}
+
+// the Quite OK Image format (qoiformat.org), the top row first
+template<typename Make>
+const char* decode_qoi(reader in, Make make)
+{
+	if (!in.left(14)) {
+		return "truncated QOI";
+	}
+	in.at = 4;
+	const uint32_t width = in.big_endian32(), height = in.big_endian32();
+	if (width > max_size || height > max_size || !valid_size(static_cast<int>(width), static_cast<int>(height))) {
+		return "bad QOI header";
+	}
+	in.at = 14;
+
+	auto &tex = make(static_cast<int>(width), static_cast<int>(height));
+	uint8_t index[64][4] = {};
+	uint8_t px[4] = { 0, 0, 0, 255 };
+	int run = 0;
+	const size_t count = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < count; ++i) {
+		if (run > 0) {
+			--run;
+		} else {
+			if (!in.left(1)) {
+				return "truncated QOI";
+			}
+			const uint8_t op = in.byte();
+			if (op == 0xfe || op == 0xff) {
+				if (!in.left(op == 0xfe ? 3 : 4)) {
+					return "truncated QOI";
+				}
+				px[0] = in.byte();
+				px[1] = in.byte();
+				px[2] = in.byte();
+				if (op == 0xff) {
+					px[3] = in.byte();
+				}
+			} else if ((op & 0xc0) == 0x00) {
+				memcpy(px, index[op], 4);
+			} else if ((op & 0xc0) == 0x40) {
+				px[0] += ((op >> 4) & 3) - 2;
+				px[1] += ((op >> 2) & 3) - 2;
+				px[2] += (op & 3) - 2;
+			} else if ((op & 0xc0) == 0x80) {
+				const int dg = (op & 0x3f) - 32;
+				const uint8_t rb = in.byte();
+				px[0] += dg - 8 + ((rb >> 4) & 0x0f);
+				px[1] += dg;
+				px[2] += dg - 8 + (rb & 0x0f);
+			} else {
+				run = op & 0x3f;
+			}
+			memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+		}
+
+		const int y = static_cast<int>(height) - 1 - static_cast<int>(i / width);
+		float *texel = tex.texel(static_cast<int>(i % width), y);
+		for (int c = 0; c < 4; ++c) {
+			texel[c] = px[c] / 255.f;
+		}
+	}
+	return nullptr;
+}
+
+bool has_extension(const std::string &path, const char *extension)
+{
+	const size_t n = strlen(extension);
+	if (path.size() < n) {
+		return false;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		if (tolower(static_cast<unsigned char>(path[path.size() - n + i])) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+// the whole file read only, or read into memory where there is no mmap
+struct texture_file::mapping
+{
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+
+#ifdef TEXTURE_FILE_MMAP
+	void *base = MAP_FAILED;
+
+	bool open(const char *path)
+	{
+		const int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			size = static_cast<size_t>(info.st_size);
+			base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		close(fd);	// the mapping keeps the file
+		data = base != MAP_FAILED ? static_cast<const uint8_t*>(base) : nullptr;
+		return data != nullptr;
+	}
+
+	~mapping()
+	{
+		if (base != MAP_FAILED) {
+			munmap(base, size);
+		}
+	}
+
+	// decoders go through it once, front to back
+	void sequential()
+	{
+		madvise(base, size, MADV_SEQUENTIAL);
+	}
+
+	// sampled in place: all of it read from disk now rather than on the first frames
+	void prefault()
+	{
+		madvise(base, size, MADV_WILLNEED);
+		const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		volatile uint8_t sum = 0;
+		for (size_t i = 0; i < size; i += page) {
+			sum += data[i];
+		}
+	}
+#else
+	std::vector<uint8_t> bytes;
+
+	bool open(const char *path)
+	{
+		FILE *f = fopen(path, "rb");
+		if (!f) {
+			return false;
+		}
+		uint8_t buffer[1 << 16];
+		for (size_t n; (n = fread(buffer, 1, sizeof(buffer), f)) > 0;) {
+			bytes.insert(bytes.end(), buffer, buffer + n);
+		}
+		fclose(f);
+		data = bytes.data();
+		size = bytes.size();
+		return size > 0;
+	}
+
+	void sequential() {}
+	void prefault() {}
+#endif
+};
+
+texture_file::texture_file(const std::string &path, const texture_options &options)
+	: Path(path), Options(options)
+{
+}
+
+texture_file::~texture_file() = default;
+
+bool texture_file::ok() const
+{
+	wait();
+	return Error.empty();
+}
+
+const char* texture_file::error() const
+{
+	wait();
+	return Error.c_str();
+}
+
+int texture_file::width() const
+{
+	wait();
+	return Count > 0 ? Levels[0].size[0] : 0;
+}
+
+int texture_file::height() const
+{
+	wait();
+	return Count > 0 ? Levels[0].size[1] : 0;
+}
+
+kernel::channel texture_file::channel() const
+{
+	wait();
+	if (Count == 0) {
+		return {};
+	}
+	return { Levels, Count, static_cast<int>(Options.sampler.filtering), static_cast<int>(Options.sampler.wrapping) };
+}
+
+bool texture_file::in_place() const
+{
+	wait();
+	return Count > 0 && !Storage;
+}
+
+float texture_file::latency() const
+{
+	wait();
+	return Latency;
+}
+
+float texture_file::decode_time() const
+{
+	wait();
+	return DecodeTime;
+}
+
+vml::texture_storage<2>& texture_file::make_storage(int width, int height)
+{
+	const int size[2] = { width, height };
+	Storage.reset(new vml::texture_storage<2>(size, texel_format::rgba32f, nullptr, Options.mipmaps, Options.layout));
+	return *Storage;
+}
+
+void texture_file::use_storage()
+{
+	Storage->generate_mipmaps();
+	Count = Storage->levels();
+	for (int i = 0; i < Count; ++i) {
+		const auto &level = Storage->level(i);
+		Levels[i] = { level.texels, { level.size[0], level.size[1], level.size[2] }, { level.pitch[0], level.pitch[1] },
+			static_cast<int>(level.layout), level.bits };
+	}
+}
+
+void texture_file::use_mapping(const uint8_t *data, int width, int height, bool top_down)
+{
+	const ptrdiff_t pitch = static_cast<ptrdiff_t>(width) * 4 * sizeof(float);
+	const uint8_t *bottom = top_down ? data + (height - 1) * pitch : data;
+	Levels[0] = { reinterpret_cast<const float*>(bottom), { width, height, 1 }, { top_down ? -pitch : pitch, pitch * height },
+		static_cast<int>(texture_layout::linear), 0 };
+	Count = 1;
+}
+
+void texture_file::decode_raw(const uint8_t *data, size_t size)
+{
+	const int width = RawSize[0], height = RawSize[1];
+	const int channels = channels_of(RawFormat), bytes = is_float(RawFormat) ? sizeof(float) : 1;
+	const size_t row = static_cast<size_t>(width) * channels * bytes;
+	if (!valid_size(width, height)) {
+		return fail("bad size");
+	}
+	if (size < row * height) {
+		return fail("smaller than its size and format");
+	}
+
+	// nothing to convert: the mapping is the texture
+	if (RawFormat == texel_format::rgba32f && !Options.mipmaps && Options.layout == texture_layout::linear) {
+		File->prefault();
+		return use_mapping(data, width, height, RawTopDown);
+	}
+
+	File->sequential();
+	auto &tex = make_storage(width, height);
+	for (int r = 0; r < height; ++r) {
+		const uint8_t *p = data + r * row;
+		const int y = RawTopDown ? height - 1 - r : r;
+		for (int x = 0; x < width; ++x) {
+			float *texel = tex.texel(x, y);
+			for (int c = 0; c < channels; ++c, p += bytes) {
+				if (bytes == 1) {
+					texel[c] = *p / 255.f;
+				} else {
+					memcpy(&texel[c], p, sizeof(float));
+				}
+			}
+			expand(texel, channels);
+		}
+	}
+	use_storage();
+}
+
+void texture_file::decode_image(const uint8_t *data, size_t size)
+{
+	const reader in = { data, size, 0 };
+	auto make = [this](int width, int height) -> vml::texture_storage<2>& { return make_storage(width, height); };
+
+	File->sequential();
+	const char *error;
+	if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) {
+		error = decode_ppm(in, make);
+	} else if (size >= 2 && data[0] == 'P' && (data[1] == 'F' || data[1] == 'f')) {
+		error = decode_pfm(in, make);
+	} else if (size >= 4 && memcmp(data, "qoif", 4) == 0) {
+		error = decode_qoi(in, make);
+	} else if (has_extension(Path, ".tga")) {	// the only one without a signature up front
+		error = decode_tga(in, make);
+	} else {
+		error = "unknown format, not PPM, PFM, TGA or QOI";
+	}
+
+	if (error) {
+		Storage.reset();
+		return fail(error);
+	}
+	use_storage();
+}
+
+void texture_file::decode()
+{
+	File.reset(new mapping);
+	if (!File->open(Path.c_str())) {
+		fail("can't be read");
+	} else {
+		try {
+			if (Raw) {
+				decode_raw(File->data, File->size);
+			} else {
+				decode_image(File->data, File->size);
+			}
+		} catch (const std::bad_alloc &) {
+			Storage.reset();
+			fail("out of memory");
+		}
+	}
+
+	// only kept while sampled from
+	if (Count == 0 || Storage) {
+		File.reset();
+	}
+}
+
+texture_loader::texture_loader()
+	: Worker(&texture_loader::run, this)
+{
+}
+
+texture_loader::~texture_loader()
+{
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Stop = true;
+	}
+	Wake.notify_one();
+	Worker.join();
+}
+
+std::shared_ptr<texture_file> texture_loader::load(const char *path, const texture_options &options)
+{
+	return enqueue(std::shared_ptr<texture_file>(new texture_file(path, options)));
+}
+
+std::shared_ptr<texture_file> texture_loader::load_raw(const char *path, int width, int height, texel_format format,
+	bool top_down, const texture_options &options)
+{
+	std::shared_ptr<texture_file> file(new texture_file(path, options));
+	file->Raw = true;
+	file->RawSize[0] = width;
+	file->RawSize[1] = height;
+	file->RawFormat = format;
+	file->RawTopDown = top_down;
+	return enqueue(std::move(file));
+}
+
+std::shared_ptr<texture_file> texture_loader::enqueue(std::shared_ptr<texture_file> file)
+{
+	job j;
+	j.file = file;
+	j.queued = steady::now();
+	file->Ready = j.done.get_future().share();
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Queue.push_back(std::move(j));
+	}
+	Wake.notify_one();
+	return file;
+}
+
+void texture_loader::run()
+{
+	for (;;) {
+		job j;
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+			Wake.wait(lock, [this] { return Stop || !Queue.empty(); });
+			if (Queue.empty()) {
+				return;
+			}
+			j = std::move(Queue.front());
+			Queue.pop_front();
+		}
+
+		const auto start = steady::now();
+		j.file->decode();
+		const auto end = steady::now();
+		j.file->DecodeTime = milliseconds(end - start);
+		j.file->Latency = milliseconds(end - j.queued);
+		j.done.set_value();
+	}
+}
+
+} } // namespace vml::render
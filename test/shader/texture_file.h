@@ -0,0 +1,141 @@
+#pragma once
+
+// Textures from files for iChannel0..3: PPM (P5, P6), PFM (PF, Pf), TGA (uncompressed and RLE) and QOI,
+// or raw dumps of a known size and texel_format
+// the file is memory mapped and decoded on a worker thread straight from the mapping, no read into a heap copy first,
+// into float rgba texels with their mip chain (see texture_storage in vml/sampler.h)
+// a raw dump of float rgba without mipmaps needs no decoding at all: it is sampled in place from the mapping
+// and the worker only faults its pages in, so the first frames don't stall on them
+//
+// load() returns at once, channel() waits for the decode; so frames only wait for the textures they read,
+// and a set of them is decoded while the rest of the startup goes on
+//
+// usage:
+//   texture_loader loader;
+//   auto noise = loader.load("noise.qoi");
+//   ... the rest of the startup ...
+//   if (!noise->ok()) printf("%s\n", noise->error());
+//   passes.bind(kernel::shader_pass::image, 0, noise->channel());
+
+#include "kernel.h"
+#include "../../vml/sampler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace vml { namespace render {
+
+struct texture_options
+{
+	vml::sampler_state sampler = { vml::filter::trilinear, vml::wrap::repeat };
+	bool mipmaps = true;
+	vml::texture_layout layout = vml::texture_layout::linear;
+};
+
+class texture_file
+{
+public:
+	~texture_file();
+
+	texture_file(const texture_file &) = delete;
+	texture_file& operator =(const texture_file &) = delete;
+
+	// all of these wait for the decode
+	bool ok() const;
+	const char* error() const;
+	int width() const;
+	int height() const;
+
+	// stays valid for the lifetime of this, unbound if the file could not be loaded
+	kernel::channel channel() const;
+
+	// sampled straight from the mapped file
+	bool in_place() const;
+
+	// ms from load() to the texels being ready, and of the decode alone
+	float latency() const;
+	float decode_time() const;
+
+	const std::string& path() const { return Path; }
+
+private:
+	friend class texture_loader;
+
+	struct mapping;
+
+	texture_file(const std::string &path, const texture_options &options);
+
+	std::string Path;
+	texture_options Options;
+	std::shared_future<void> Ready;
+
+	// set by the worker before Ready
+	std::string Error;
+	std::unique_ptr<mapping> File;
+	std::unique_ptr<vml::texture_storage<2>> Storage;
+	kernel::channel_level Levels[vml::max_texture_levels] = {};
+	int Count = 0;
+	float Latency = 0;
+	float DecodeTime = 0;
+
+	void wait() const { Ready.wait(); }
+	void decode();
+	void decode_raw(const uint8_t *data, size_t size);
+	void decode_image(const uint8_t *data, size_t size);
+
+	// where the texels end up: decoded into a storage or the mapping itself
+	vml::texture_storage<2>& make_storage(int width, int height);
+	void use_storage();
+	void use_mapping(const uint8_t *data, int width, int height, bool top_down);
+	void fail(const char *what) { Error = Path + ": " + what; }
+
+	// of load_raw()
+	bool Raw = false;
+	int RawSize[2] = {};
+	vml::texel_format RawFormat = vml::texel_format::rgba32f;
+	bool RawTopDown = false;
+};
+
+// one worker thread decoding the files in the order they were loaded
+class texture_loader
+{
+public:
+	texture_loader();
+	~texture_loader();	// finishes what was loaded
+
+	texture_loader(const texture_loader &) = delete;
+	texture_loader& operator =(const texture_loader &) = delete;
+
+	// the format from the first bytes of the file
+	std::shared_ptr<texture_file> load(const char *path, const texture_options &options = {});
+
+	// tightly packed rows of format, row 0 the bottom unless top_down
+	std::shared_ptr<texture_file> load_raw(const char *path, int width, int height, vml::texel_format format,
+		bool top_down = false, const texture_options &options = {});
+
+private:
+	struct job
+	{
+		std::shared_ptr<texture_file> file;
+		std::promise<void> done;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	std::mutex Lock;
+	std::condition_variable Wake;
+	std::deque<job> Queue;
+	bool Stop = false;
+	std::thread Worker;
+
+	std::shared_ptr<texture_file> enqueue(std::shared_ptr<texture_file> file);
+	void run();
+};
+
+} } // namespace vml::render
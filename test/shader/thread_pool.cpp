@@ -0,0 +1,290 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace vml { namespace render {
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+// the CPUs the process may run on (taskset, cgroups, ...), read once, empty where it can't be known
+const std::vector<int>& allowed_cpus()
+{
+	static const std::vector<int> cpus = []
+	{
+		std::vector<int> out;
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+				if (CPU_ISSET(cpu, &set)) {
+					out.push_back(cpu);
+				}
+			}
+		}
+#elif defined(_WIN32)
+		DWORD_PTR process, system;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) {
+			for (int cpu = 0; cpu < static_cast<int>(sizeof(process) * 8); ++cpu) {
+				if (process & (DWORD_PTR(1) << cpu)) {
+					out.push_back(cpu);
+				}
+			}
+		}
+#endif
+		return out;
+	}();
+	return cpus;
+}
+
+// false leaves the thread where it was, free to run on any allowed CPU
+bool pin_thread(std::thread &thread, int cpu)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+	return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu) != 0;
+#else
+	(void)thread;
+	(void)cpu;
+	return false;
+#endif
+}
+
+// pools alive in the process, only a lone one pins its workers
+std::atomic<int> live_pools { 0 };
+
+float microseconds(steady::duration d)
+{
+	return std::chrono::duration<float, std::micro>(d).count();
+}
+
+size_t next_pow2(size_t n)
+{
+	size_t out = 1;
+	while (out < n) {
+		out *= 2;
+	}
+	return out;
+}
+
+} // anonymous namespace
+
+void wait_on(std::atomic<uint32_t> &word, uint32_t value)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+	WaitOnAddress(&word, &value, sizeof(value), INFINITE);
+#else
+	while (word.load(std::memory_order_acquire) == value) {
+		std::this_thread::yield();
+	}
+#endif
+}
+
+void wake_all(std::atomic<uint32_t> &word)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+	WakeByAddressAll(&word);
+#else
+	(void)word;
+#endif
+}
+
+thread_pool::task_queue::task_queue(size_t capacity)
+	: Cells(new cell[next_pow2(std::max<size_t>(capacity, 2))]),
+	Mask(next_pow2(std::max<size_t>(capacity, 2)) - 1),
+	Enqueue(0),
+	Dequeue(0)
+{
+	for (size_t i = 0; i <= Mask; ++i) {
+		Cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+bool thread_pool::task_queue::push(const task &t)
+{
+	auto pos = Enqueue.load(std::memory_order_relaxed);
+	for (;;) {
+		auto &c = Cells[pos & Mask];
+		const auto seq = c.sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+		if (diff == 0) {
+			if (Enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				c.data = t;
+				c.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; // full
+		} else {
+			pos = Enqueue.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool thread_pool::task_queue::pop(task &t)
+{
+	auto pos = Dequeue.load(std::memory_order_relaxed);
+	for (;;) {
+		auto &c = Cells[pos & Mask];
+		const auto seq = c.sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0) {
+			if (Dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				t = c.data;
+				c.sequence.store(pos + Mask + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; // empty
+		} else {
+			pos = Dequeue.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+thread_pool::thread_pool(int threads, bool pin)
+	: Threads(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+	Queue(static_cast<size_t>(Threads)),
+	Started(new steady::time_point[Threads]),
+	Finished(new steady::time_point[Threads])
+{
+	// several pools (or more workers than CPUs) would stack their workers on the same CPUs
+	const auto &cpus = allowed_cpus();
+	pin = live_pools.fetch_add(1) == 0 && pin && static_cast<size_t>(Threads) <= cpus.size();
+
+	// worker 0 is whoever calls run(), it keeps its own affinity
+	// the others go to one allowed CPU each, in order
+	Workers.reserve(Threads - 1);
+	for (int i = 1; i < Threads; ++i) {
+		Workers.emplace_back([this] { worker_loop(); });
+		if (pin && pin_thread(Workers.back(), cpus[i])) {
+			++Pinned;
+		}
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	for (size_t i = 0; i < Workers.size(); ++i) {
+		while (!Queue.push(task{ nullptr, 0 })) {
+			std::this_thread::yield();
+		}
+	}
+	Epoch.fetch_add(1, std::memory_order_release);
+	wake_all(Epoch);
+
+	for (auto &w : Workers) {
+		w.join();
+	}
+	live_pools.fetch_sub(1);
+}
+
+void thread_pool::run(const std::function<void(int worker)> &job)
+{
+	const auto start = steady::now();
+
+	Pending.store(static_cast<uint32_t>(Threads - 1), std::memory_order_relaxed);
+	for (int i = 1; i < Threads; ++i) {
+		Queue.push(task{ &job, i }); // can't be full, there is never more than one task per worker in flight
+	}
+	Epoch.fetch_add(1, std::memory_order_release);
+	wake_all(Epoch);
+
+	Started[0] = steady::now();
+	job(0);
+	Finished[0] = steady::now();
+
+	for (int i = 0; i < VML_THREAD_POOL_SPIN && Pending.load(std::memory_order_acquire) != 0; ++i) {
+		cpu_relax();
+	}
+	for (auto pending = Pending.load(std::memory_order_acquire); pending != 0; pending = Pending.load(std::memory_order_acquire)) {
+		wait_on(Pending, pending);
+	}
+
+	const auto end = steady::now();
+	const auto last_start = *std::max_element(Started.get(), Started.get() + Threads);
+	const auto last_finish = *std::max_element(Finished.get(), Finished.get() + Threads);
+	Stats.wake = microseconds(last_start - start);
+	Stats.join = microseconds(end - last_finish);
+	Stats.total = microseconds(end - start);
+
+	auto longest = steady::duration::zero();
+	for (int i = 0; i < Threads; ++i) {
+		longest = std::max(longest, Finished[i] - Started[i]);
+	}
+	Stats.overhead = microseconds(end - start - longest);
+}
+
+void thread_pool::worker_loop()
+{
+	for (;;) {
+		// read before looking at the queue so a submit in between makes wait_on() return straight away
+		const auto epoch = Epoch.load(std::memory_order_acquire);
+
+		task t;
+		if (Queue.pop(t)) {
+			if (!t.job) {
+				return;
+			}
+			execute(t);
+			continue;
+		}
+
+		bool woken = false;
+		for (int i = 0; i < VML_THREAD_POOL_SPIN && !woken; ++i) {
+			cpu_relax();
+			woken = Epoch.load(std::memory_order_relaxed) != epoch;
+		}
+		if (!woken) {
+			wait_on(Epoch, epoch);
+		}
+	}
+}
+
+void thread_pool::execute(const task &t)
+{
+	Started[t.worker] = steady::now();
+	(*t.job)(t.worker);
+	Finished[t.worker] = steady::now();
+
+	if (Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		wake_all(Pending);
+	}
+}
+
+} } // namespace vml::render
@@ -0,0 +1,104 @@
+#pragma once
+
+// Persistent worker threads, owned by whoever renders (see scheduler.h)
+// threads are created once, pinned to a CPU each and park on a futex between frames
+// only the one pool of a process pins, onto the CPUs its affinity allows, and only if there are enough of them
+// a frame hands out one task per worker through a lock free queue, the calling thread is worker 0
+// config #define's
+// VML_THREAD_POOL_SPIN - how many times a parked worker checks for work before sleeping (default 4096)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifndef VML_THREAD_POOL_SPIN
+#define VML_THREAD_POOL_SPIN 4096
+#endif
+
+namespace vml { namespace render {
+
+// per run() timings, in microseconds
+// wake and join also count the time a worker wasn't scheduled at all (more threads than cores)
+struct dispatch_stats
+{
+	float wake;		// from submitting to the last worker starting
+	float join;		// from the last worker finishing to run() returning
+	float total;	// wall time of run()
+	float overhead;	// total minus the longest worker: what the pool itself costs per run
+};
+
+// futex parking (WaitOnAddress on Windows, a yield loop elsewhere), also used by the frame pipeline
+// wait_on() sleeps while word == value and can return spuriously, wake_all() wakes everything waiting on word
+void wait_on(std::atomic<uint32_t> &word, uint32_t value);
+void wake_all(std::atomic<uint32_t> &word);
+
+class thread_pool
+{
+public:
+	// threads <= 0 is all the cores
+	// pin = false leaves the workers unpinned, for a pool that shares the cores with other busy threads
+	explicit thread_pool(int threads = 0, bool pin = true);
+	~thread_pool();
+
+	thread_pool(const thread_pool &) = delete;
+	thread_pool& operator =(const thread_pool &) = delete;
+
+	int threads() const { return Threads; }
+
+	// workers pinned to a CPU, none if pinning was off or failed
+	int pinned() const { return Pinned; }
+
+	// calls job(worker) once for every worker in [0, threads()) and returns when they all finished
+	// not reentrant, only one thread may call run() at a time
+	void run(const std::function<void(int worker)> &job);
+
+	const dispatch_stats& stats() const { return Stats; }
+
+private:
+	struct task
+	{
+		const std::function<void(int)> *job; // nullptr stops the worker
+		int worker;
+	};
+
+	// bounded MPMC queue, http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+	class task_queue
+	{
+	public:
+		explicit task_queue(size_t capacity);
+		bool push(const task &t);
+		bool pop(task &t);
+
+	private:
+		struct alignas(64) cell
+		{
+			std::atomic<size_t> sequence;
+			task data;
+		};
+
+		std::unique_ptr<cell[]> Cells;
+		size_t Mask;
+		alignas(64) std::atomic<size_t> Enqueue;
+		alignas(64) std::atomic<size_t> Dequeue;
+	};
+
+	int Threads;
+	int Pinned = 0;
+	task_queue Queue;
+	std::vector<std::thread> Workers;
+	std::unique_ptr<std::chrono::steady_clock::time_point[]> Started;
+	std::unique_ptr<std::chrono::steady_clock::time_point[]> Finished;
+	dispatch_stats Stats = {};
+
+	alignas(64) std::atomic<uint32_t> Epoch { 0 };		// bumped on every submit, workers sleep on it
+	alignas(64) std::atomic<uint32_t> Pending { 0 };	// tasks not finished yet, run() sleeps on it
+
+	void worker_loop();
+	void execute(const task &t);
+};
+
+} } // namespace vml::render
@@ -0,0 +1,191 @@
+#include "video.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace vml { namespace render {
+
+namespace {
+
+// BT.601 studio range, from 8-bit rgb
+uint8_t luma(float r, float g, float b)
+{
+	return static_cast<uint8_t>(16.f + .256788f * r + .504129f * g + .097906f * b + .5f);
+}
+
+uint8_t chroma_blue(float r, float g, float b)
+{
+	return static_cast<uint8_t>(128.f - .148223f * r - .290993f * g + .439216f * b + .5f);
+}
+
+uint8_t chroma_red(float r, float g, float b)
+{
+	return static_cast<uint8_t>(128.f + .439216f * r - .367788f * g - .071427f * b + .5f);
+}
+
+} // anonymous namespace
+
+video_renderer::video_renderer(int width, int height, const video_options &options, shade_func shade)
+	: Width(width), Height(height), Options(options), Shade(std::move(shade))
+{
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+	Threads = options.threads > 0 ? options.threads : std::max(cores, 1);
+	Depth = options.sequential ? 1 : options.depth > 0 ? options.depth : Threads;
+}
+
+uniforms video_renderer::frame_uniforms(const uniforms &u, int frame) const
+{
+	uniforms f = u;
+	f.time_delta = static_cast<float>(Options.fps_den) / Options.fps_num;
+	f.time = static_cast<float>(static_cast<double>(frame) * Options.fps_den / Options.fps_num);
+	f.frame = frame;
+	return f;
+}
+
+size_t video_renderer::frame_bytes() const
+{
+	const size_t pixels = static_cast<size_t>(Width) * Height;
+	if (Options.format == video_format::rgb24) {
+		return pixels * 3;
+	}
+	const size_t chroma = static_cast<size_t>((Width + 1) / 2) * ((Height + 1) / 2);
+	return pixels + 2 * chroma;
+}
+
+// fb is rgb8; Y4M planes are Y, then Cb and Cr at half the size, each the average of a 2x2 block (the JPEG siting)
+void video_renderer::encode(const framebuffer &fb, uint8_t *out) const
+{
+	const auto *pixels = static_cast<const uint8_t*>(fb.pixels);
+	if (Options.format == video_format::rgb24) {
+		for (int y = 0; y < Height; ++y) {
+			std::copy_n(pixels + static_cast<size_t>(y) * fb.pitch, Width * 3, out + static_cast<size_t>(y) * Width * 3);
+		}
+		return;
+	}
+
+	uint8_t *luma_plane = out;
+	for (int y = 0; y < Height; ++y) {
+		const uint8_t *row = pixels + static_cast<size_t>(y) * fb.pitch;
+		for (int x = 0; x < Width; ++x) {
+			*luma_plane++ = luma(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
+		}
+	}
+
+	const int chroma_width = (Width + 1) / 2, chroma_height = (Height + 1) / 2;
+	uint8_t *blue_plane = out + static_cast<size_t>(Width) * Height;
+	uint8_t *red_plane = blue_plane + static_cast<size_t>(chroma_width) * chroma_height;
+	for (int y = 0; y < chroma_height; ++y) {
+		const uint8_t *top = pixels + static_cast<size_t>(2 * y) * fb.pitch;
+		const uint8_t *bottom = pixels + static_cast<size_t>(std::min(2 * y + 1, Height - 1)) * fb.pitch;
+		for (int x = 0; x < chroma_width; ++x) {
+			const int left = 2 * x * 3, right = std::min(2 * x + 1, Width - 1) * 3;
+			float rgb[3];
+			for (int c = 0; c < 3; ++c) {
+				rgb[c] = .25f * (top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c]);
+			}
+			*blue_plane++ = chroma_blue(rgb[0], rgb[1], rgb[2]);
+			*red_plane++ = chroma_red(rgb[0], rgb[1], rgb[2]);
+		}
+	}
+}
+
+bool video_renderer::write_header(FILE *out) const
+{
+	if (Options.format != video_format::y4m) {
+		return true;
+	}
+	return fprintf(out, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n", Width, Height, Options.fps_num, Options.fps_den) > 0;
+}
+
+// takes the next frame as soon as it has a slot to go to, frames before first (sequential only) are shaded but not kept
+void video_renderer::work(const uniforms &u, int threads_per_frame)
+{
+	tile_scheduler scheduler(threads_per_frame, 32, 8, Depth == 1);
+	image frame(Width, Height, format::rgb8);
+	const int slots = static_cast<int>(Slots.size());
+
+	for (;;) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+			Changed.wait(lock, [this, slots]
+			{
+				return Failed || Next > Options.last || Next < Options.first || Next - Options.first < Written + slots;
+			});
+			if (Failed || Next > Options.last) {
+				return;
+			}
+			index = Next++;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		Shade(frame.view(), frame_uniforms(u, index), scheduler);
+		if (index < Options.first) {
+			continue;
+		}
+		slot &s = Slots[(index - Options.first) % slots];
+		encode(frame.view(), s.bytes.data());
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			s.ready = true;
+			Shading += elapsed.count();
+		}
+		Changed.notify_all();
+	}
+}
+
+bool video_renderer::render(FILE *out, const uniforms &u)
+{
+	const auto start = std::chrono::steady_clock::now();
+	Stats = {};
+	Slots.assign(2 * Depth, slot());
+	for (auto &s : Slots) {
+		s.bytes.resize(frame_bytes());
+	}
+	Next = Options.sequential && Options.first > 0 ? 0 : Options.first;
+	Written = 0;
+	Failed = !write_header(out);
+	Shading = 0;
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < Depth && !Failed; ++i) {
+		workers.emplace_back(&video_renderer::work, this, std::cref(u), std::max(Threads / Depth, 1));
+	}
+
+	for (int frame = Options.first; frame <= Options.last && !Failed; ++frame) {
+		slot &s = Slots[(frame - Options.first) % Slots.size()];
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+			Changed.wait(lock, [&s] { return s.ready; });
+			const int waiting = static_cast<int>(std::count_if(Slots.begin(), Slots.end(), [](const slot &w) { return w.ready; }));
+			Stats.reordered = std::max(Stats.reordered, waiting - 1);
+		}
+
+		// the slot is the writer's until it is marked free again
+		bool ok = Options.format != video_format::y4m || fputs("FRAME\n", out) >= 0;
+		ok = ok && fwrite(s.bytes.data(), 1, s.bytes.size(), out) == s.bytes.size();
+
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			s.ready = false;
+			Written += ok;
+			Failed = !ok;
+		}
+		Changed.notify_all();
+	}
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	Failed = Failed || fflush(out) != 0;
+
+	Stats.frames = Written;
+	Stats.elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Stats.shading = Written > 0 ? static_cast<float>(Shading / Written) : 0.f;
+	return !Failed;
+}
+
+} } // namespace vml::render
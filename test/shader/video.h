@@ -0,0 +1,104 @@
+#pragma once
+
+// Offline video: frames first..last of the shader at a fixed iTimeDelta, written in order to a Y4M or raw stream
+// nothing reads the clock (frame n is at iTime n / fps), so the same options give the same bytes and it runs
+// as fast as the cores go, not in real time
+//
+// several frames are in flight: depth workers each shade a whole frame of their own (on threads / depth cores)
+// and convert it to the output bytes; they finish in any order, so the frames wait in a reorder buffer of 2 * depth
+// slots for the ones before them to be written; a worker that gets that far ahead of the writer waits for its slot
+// frames depending on the one before (the buffers of a multipass shader) can only go one at a time:
+// options.sequential shades them in order over all the cores, from frame 0 on even if only first..last are written
+//
+// Y4M is 4:2:0 BT.601 (studio range), what ffmpeg and most players read as is
+// raw is packed rgb24: ffmpeg -f rawvideo -pix_fmt rgb24 -s <w>x<h> -r <fps> -i -
+//
+// usage:
+//   video_renderer video(w, h, options, [&shader](const framebuffer &fb, const uniforms &u, tile_scheduler &scheduler)
+//   {
+//     shade(shader, fb, u, scheduler);
+//   });
+//   video.render(stdout, u);	// iMouse and iDate of u, iTime, iTimeDelta and iFrame per frame
+
+#include "render.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace vml { namespace render {
+
+enum class video_format
+{
+	y4m,
+	rgb24,
+};
+
+struct video_options
+{
+	int first = 0;
+	int last = 0;					// included
+	int fps_num = 60;				// iTimeDelta is fps_den / fps_num
+	int fps_den = 1;
+	video_format format = video_format::y4m;
+	int threads = 0;				// all the cores if <= 0
+	int depth = 0;					// frames in flight, threads if <= 0
+	bool sequential = false;		// a frame reads the one before
+};
+
+struct video_stats
+{
+	int frames;			// written
+	float elapsed;		// ms, all of render()
+	float shading;		// ms a frame took to shade and convert, on average
+	int reordered;		// the most frames that were waiting for an earlier one to be written
+};
+
+class video_renderer
+{
+public:
+	// called from the workers, depth frames at a time (each with a scheduler of its own) unless sequential
+	using shade_func = std::function<void(const framebuffer &fb, const uniforms &u, tile_scheduler &scheduler)>;
+
+	video_renderer(int width, int height, const video_options &options, shade_func shade);
+
+	// all the frames, returns false if the stream could not be written (the frames after that aren't shaded)
+	bool render(FILE *out, const uniforms &u);
+
+	// of the last render()
+	const video_stats& stats() const { return Stats; }
+
+private:
+	struct slot
+	{
+		std::vector<uint8_t> bytes;
+		bool ready = false;
+	};
+
+	int Width;
+	int Height;
+	video_options Options;
+	shade_func Shade;
+	int Threads;
+	int Depth;
+	video_stats Stats = {};
+
+	// frames from Written on are in Slots[(frame - first) % size], the workers take them from Next
+	std::mutex Lock;
+	std::condition_variable Changed;
+	std::vector<slot> Slots;
+	int Next = 0;
+	int Written = 0;
+	bool Failed = false;
+	double Shading = 0;		// ms, summed over the frames
+
+	uniforms frame_uniforms(const uniforms &u, int frame) const;
+	size_t frame_bytes() const;
+	void encode(const framebuffer &fb, uint8_t *out) const;
+	void work(const uniforms &u, int threads_per_frame);
+	bool write_header(FILE *out) const;
+};
+
+} } // namespace vml::render
@@ -3,6 +3,7 @@
 #define CATCH_CONFIG_NO_CPP17_UNCAUGHT_EXCEPTIONS
 #define CATCH_CONFIG_MAIN // https://github.com/catchorg/Catch2/blob/master/docs/configuration.md#main-implementation
 #define CATCH_CONFIG_FAST_COMPILE // https://github.com/catchorg/Catch2/blob/master/docs/configuration.md#catch_config_fast_compile
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // SIGSTKSZ is no longer a constant in newer glibc
 #include "catch.hpp"
 
 #ifdef _MSC_VER
@@ -11,9 +12,33 @@
 #pragma warning(disable: 4244)
 #endif
 
+#define VML_QUAD_SHADING
 #include "../vml/vector.h"
 #include "../vml/matrix.h"
 #include "../vml/vector_functions.h"
+#include "../vml/layout.h"
+#include "../vml/rng.h"
+#include "../vml/sampler.h"
+#include "../vml/noise.h"
+#include "shader/adaptive.h"
+#include "shader/dynamic_resolution.h"
+#include "shader/frame_cache.h"
+#include "shader/interleaved.h"
+#include "shader/multipass.h"
+#include "shader/pipeline.h"
+#include "shader/scheduler.h"
+#include "shader/supersampling.h"
+#include "shader/texture_file.h"
+#include "shader/video.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 
 using dvec4 = vml::vector<double, 0, 1, 2, 3>;
 using dvec3 = vml::vector<double, 0, 1, 2>;
@@ -367,6 +392,1301 @@ TEST_CASE("inout args")
 	//inout_func(v.xyz);
 }
 
+TEST_CASE("compile time constants")
+{
+	using namespace vml::literals;
+	static_assert(std::is_same<decltype(2.0_c), vml::c<2>>::value, "2.0");
+	static_assert(std::is_same<decltype(0.25_c), vml::c<1, 4>>::value, "0.25");
+	static_assert(std::is_same<decltype(1e-3_c), vml::c<1, 1000>>::value, "1e-3");
+	static_assert(std::is_same<decltype(-2.5_c), vml::c<-5, 2>>::value, "-2.5");
+	static_assert(std::is_same<decltype(2_c), vml::c<2, 1, true>>::value, "2");
+	static_assert(std::is_same<decltype(-2_c), vml::c<-2, 1, true>>::value, "-2");
+	static_assert(std::is_same<decltype(1e3_c), vml::c<1000>>::value, "1e3");
+
+	vec3 v(1.5f, 2.f, -3.f);
+
+	SECTION("pow") {
+		vec3 p = pow(v, 2.0_c);
+		REQUIRE(p.x == Approx(2.25f));
+		REQUIRE(p.z == Approx(9.f));
+		REQUIRE(pow(3.f, 5.0_c) == Approx(243.f));
+		REQUIRE(pow(2.f, -1.0_c) == Approx(.5f));
+		REQUIRE(pow(4.f, 0.5_c) == Approx(2.f));
+		REQUIRE(pow(2.0_c, 3.f) == Approx(8.f));
+		REQUIRE(pow(v.xyz, 3.0_c).z == Approx(-27.f));
+	}
+
+	SECTION("mod") {
+		vec2 m = mod(vec2(5.f, -1.f), 2.0_c);
+		REQUIRE(m.x == Approx(1.f));
+		REQUIRE(m.y == Approx(1.f));
+		REQUIRE(mod(7.5f, 3.0_c) == Approx(1.5f));
+
+		// not a power of 2: never below 0 just under its multiples, a rounded reciprocal would floor one too high
+		REQUIRE(mod(std::nextafter(15.f, 0.f), 3.0_c) >= 0.f);
+		REQUIRE(mod(std::nextafter(15.f, 0.f), 3.0_c) == mod(std::nextafter(15.f, 0.f), 3.f));
+		REQUIRE(mod(1.66666663f, vml::c<1, 3>()) >= 0.f);
+		REQUIRE(mod(9.f, 3.0_c) == 0.f);
+	}
+
+	SECTION("arithmetic") {
+		vec3 d = v / 2.0_c;
+		REQUIRE(d.x == Approx(.75f));
+		REQUIRE((v.xyz * 2.0_c).y == Approx(4.f));
+		REQUIRE(3.f / 2.0_c == Approx(1.5f));
+		REQUIRE(1.f < 2.0_c);
+		REQUIRE(mix(0.f, 2.f, 0.25_c) == Approx(.5f));
+	}
+
+	SECTION("integer operands") {
+		// as with the plain literal, only an integer constant keeps integer arithmetic
+		static_assert(std::is_same<decltype(3 * 2_c), int>::value, "3 * 2");
+		static_assert(std::is_same<decltype(3 * 2.0_c), double>::value, "3 * 2.0");
+		static_assert(std::is_same<decltype(7u / 2.0_c), double>::value, "7u / 2.0");
+		static_assert(std::is_same<decltype(7u / 2_c), unsigned>::value, "7u / 2");
+
+		int i = 3;
+		REQUIRE(i * 0.5_c == 1.5);
+		REQUIRE(0.5_c * i == 1.5);
+		REQUIRE(i / 0.5_c == 6.0);
+		REQUIRE(i / vml::c<1, 2>() == 6.0);
+		REQUIRE(0.5_c / 2 == .25);
+		REQUIRE(7u / 2.0_c == 3.5);
+		REQUIRE(17u / 4.0_c == 4.25);
+		REQUIRE(-7 / 2.0_c == -3.5);
+		REQUIRE(7 / 3.0_c == 7 / 3.0);
+		REQUIRE(i + 0.25_c == 3.25);
+		REQUIRE(i - 2.5_c == .5);
+		REQUIRE(i < 3.5_c);
+		REQUIRE(i != 3.5_c);
+
+		REQUIRE(17u / 4_c == 4u);	// shift
+		REQUIRE(-7 / 2_c == -3);
+		REQUIRE(i * -2_c == -6);
+		REQUIRE(i == 3_c);
+		REQUIRE(7 / 2_c == 3);
+	}
+}
+
+TEST_CASE("lookup tables")
+{
+	namespace lut = vml::detail::lut;
+
+	float max_sin = 0, max_exp2 = 0, max_log2 = 0;
+	for (int i = -1000; i <= 1000; ++i) {
+		const float x = i * 0.0123f;
+		max_sin = std::max(max_sin, std::abs(lut::sin(x) - std::sin(x)));
+		max_sin = std::max(max_sin, std::abs(lut::cos(x) - std::cos(x)));
+		max_exp2 = std::max(max_exp2, std::abs(lut::exp2(x) / std::exp2(x) - 1));
+		max_log2 = std::max(max_log2, std::abs(lut::log2(1 + i * i * 0.01f) - std::log2(1 + i * i * 0.01f)));
+	}
+	REQUIRE(max_sin < 1e-4f);
+	REQUIRE(max_exp2 < 2e-5f);
+	REQUIRE(max_log2 < 5e-5f);
+
+	REQUIRE(lut::exp2(-200.f) == 0.f);
+	REQUIRE(lut::exp2(3.f) == 8.f);
+
+	// negative, and just below an integer where the fraction rounds up to the end of the table
+	for (const float x : { -1e-9f, -1.f, -2.5f, -125.9f, std::nextafter(1.f, 0.f), std::nextafter(-3.f, -4.f), 127.99999f }) {
+		REQUIRE(lut::exp2(x) / std::exp2(x) == Approx(1.f).epsilon(2e-5f));
+	}
+	REQUIRE(lut::exp2(-1.f) == .5f);
+	REQUIRE(lut::exp2(-1e-9f) == 1.f);
+	REQUIRE(lut::log2(0.25f) == -2.f);
+	REQUIRE(std::isnan(lut::log2(-1.f)));
+}
+
+TEST_CASE("quad derivatives")
+{
+	namespace quad = vml::detail::quad;
+	quad::context ctx;
+
+	// lane = x | y << 1 around pixel (10, 20)
+	vec2 dx[4], dy[4];
+	float width[4], nested[4];
+	quad::shade(ctx, [&](int lane)
+	{
+		const vec2 p(10.f + (lane & 1), 20.f + (lane >> 1));
+		dx[lane] = dFdx(p * p);
+		dy[lane] = dFdy(p * p);
+		width[lane] = fwidth(3.f * p.x - p.y);
+		nested[lane] = dFdy(dFdx(p.x * p.y)); // depends on an earlier derivative
+	});
+
+	REQUIRE(dx[0].x == 21.f); // 11^2 - 10^2
+	REQUIRE(dx[2].x == 21.f);
+	REQUIRE(dx[0].y == 0.f);
+	REQUIRE(dy[1].y == 41.f); // 21^2 - 20^2
+	REQUIRE(dy[3].x == 0.f);
+	REQUIRE(width[0] == 4.f);
+	REQUIRE(width[3] == 4.f);
+	REQUIRE(nested[0] == 1.f); // dFdx is y per row: 21 - 20
+	REQUIRE(ctx.pass == 2); // settled on the third pass
+
+	// outside of a quad there is nothing to differentiate
+	REQUIRE(dFdx(vec2(1.f, 2.f)).x == 0.f);
+}
+
+TEST_CASE("random numbers")
+{
+	namespace rng = vml::rng;
+
+	auto a = rng::seed(vec2(10.f, 20.f), 3);
+	auto b = rng::seed(vec2(10.f, 20.f), 3);
+	REQUIRE(rng::next_float(a) == rng::next_float(b));
+	REQUIRE(rng::seed(vec2(10.f, 20.f), 4).key != a.key);
+	REQUIRE(rng::seed(vec2(10.f, 20.f), 3, 1).key != a.key);
+	REQUIRE(rng::seed(vec2(11.f, 20.f), 3).key != a.key);
+
+	float sum = 0, sum_z = 0, sum_cos_z = 0;
+	bool in_range = true, on_disk = true, on_sphere = true, on_hemisphere = true;
+	const vec3 n = normalize(vec3(1.f, -2.f, 0.5f));
+	constexpr int count = 4096;
+	for (int i = 0; i < count; ++i) {
+		const vec3 u = rng::next_vec3(a);
+		in_range &= u.x >= 0.f && u.x < 1.f && u.y >= 0.f && u.y < 1.f && u.z >= 0.f && u.z < 1.f;
+		sum += u.x + u.y + u.z;
+
+		const vec2 d = rng::disk(u.xy);
+		on_disk &= dot(d, d) <= 1.f;
+		on_sphere &= std::abs(length(rng::sphere(u.xy)) - 1.f) < 1e-5f;
+		const vec3 h = rng::hemisphere(u.xy, n);
+		on_hemisphere &= std::abs(length(h) - 1.f) < 1e-5f && dot(h, n) >= -1e-6f;
+
+		sum_z += rng::hemisphere(u.xy).z;
+		sum_cos_z += rng::hemisphere_cosine(u.xy).z;
+	}
+	REQUIRE(in_range);
+	REQUIRE(on_disk);
+	REQUIRE(on_sphere);
+	REQUIRE(on_hemisphere);
+	REQUIRE(sum / (3 * count) == Approx(.5f).epsilon(.02f));
+	REQUIRE(sum_z / count == Approx(.5f).epsilon(.03f)); // E[cos] uniform
+	REQUIRE(sum_cos_z / count == Approx(2.f / 3).epsilon(.03f)); // E[cos] cosine weighted
+}
+
+TEST_CASE("texture sampling")
+{
+	// 4x2: black white black white / red green blue 50% grey, bottom row first
+	const uint8_t rgba[] = {
+		0, 0, 0, 255,   255, 255, 255, 255,   0, 0, 0, 255,   255, 255, 255, 255,
+		255, 0, 0, 255,   0, 255, 0, 255,   0, 0, 255, 255,   0, 0, 0, 0,
+	};
+	vml::texture_storage<2> tex({ 4, 2 }, vml::texel_format::rgba8, rgba);
+	REQUIRE(tex.levels() == 3); // 4x2, 2x1, 1x1
+
+	const auto nearest = tex.bind({ vml::filter::nearest, vml::wrap::repeat });
+	REQUIRE(texelFetch(nearest, ivec2(1, 1), 0).g == 1.f);
+	REQUIRE(texelFetch(nearest, ivec2(4, 0), 0).a == 0.f); // outside
+	REQUIRE(textureSize(nearest, 1).x == 2);
+	REQUIRE(textureLod(nearest, vec2(.3f, .2f), 0.f).r == 1.f);
+	REQUIRE(textureLod(nearest, vec2(1.3f, -.8f), 0.f).r == 1.f); // repeat
+
+	// halfway between the texel centers of the bottom row
+	const auto bilinear = tex.bind({ vml::filter::bilinear, vml::wrap::clamp });
+	REQUIRE(textureLod(bilinear, vec2(.25f, .25f), 0.f).r == Approx(.5f));
+	REQUIRE(textureLod(bilinear, vec2(-1.f, .25f), 0.f).r == 0.f); // clamped to the first texel
+	const auto mirror = tex.bind({ vml::filter::nearest, vml::wrap::mirror });
+	REQUIRE(textureLod(mirror, vec2(-.1f, .25f), 0.f).r == 0.f); // the first texel again
+	REQUIRE(textureLod(mirror, vec2(1.1f, .25f), 0.f).r == 1.f); // the last one
+
+	// mips are box filtered, trilinear blends two of them
+	REQUIRE(textureLod(bilinear, vec2(.5f), 2.f).g == Approx((1 + 1 + 1 + 0.f) / 8));
+	const auto trilinear = tex.bind({ vml::filter::trilinear, vml::wrap::repeat });
+	const float level1 = textureLod(trilinear, vec2(.25f, .5f), 1.f).r;
+	const float level2 = textureLod(trilinear, vec2(.25f, .5f), 2.f).r;
+	REQUIRE(textureLod(trilinear, vec2(.25f, .5f), 1.5f).r == Approx((level1 + level2) / 2));
+
+	// texture() takes the level from how fast the coordinates change across the quad: 2 texels a pixel is level 1
+	vml::detail::quad::context ctx;
+	float lod[4];
+	vml::detail::quad::shade(ctx, [&](int lane)
+	{
+		const float p[2] = { (lane & 1) * 2.f / 4, (lane >> 1) * 2.f / 2 };
+		lod[lane] = trilinear.implicit_lod(p);
+	});
+	REQUIRE(lod[0] == Approx(1.f));
+
+	// 3D, 8 texels around the center
+	const float cube[2 * 2 * 2] = { 0, 1, 0, 1, 0, 1, 0, 1 };
+	vml::texture_storage<3> volume({ 2, 2, 2 }, vml::texel_format::r32f, cube, false);
+	const auto s3 = volume.bind({ vml::filter::bilinear, vml::wrap::clamp });
+	REQUIRE(volume.levels() == 1);
+	REQUIRE(textureLod(s3, vec3(.5f), 0.f).r == Approx(.5f));
+	REQUIRE(texelFetch(s3, ivec3(1, 1, 1), 0).r == 1.f);
+	REQUIRE(texelFetch(s3, ivec3(1, 1, 1), 0).a == 1.f); // no alpha in r32f
+
+	// nothing bound
+	REQUIRE(texture(vml::sampler2D(), vec2(.5f)).a == 0.f);
+}
+
+TEST_CASE("cubemap sampling")
+{
+	// every direction goes back to itself through its face
+	auto rng = vml::rng::seed(7u, 8u, 9u);
+	bool round_trip = true;
+	for (int i = 0; i < 64; ++i) {
+		const vec3 r = vml::rng::next_vec3(rng) * 2.f - 1.f;
+		const float d[3] = { r.x, r.y, r.z };
+		float s, t, back[3];
+		const int face = vml::detail::sampling::cube_face(d, s, t);
+		vml::detail::sampling::cube_direction(face, s, t, back);
+		const float ma = std::max(std::fabs(d[0]), std::max(std::fabs(d[1]), std::fabs(d[2])));
+		for (int axis = 0; axis < 3; ++axis) {
+			round_trip &= std::fabs(back[axis] - d[axis] / ma) < 1e-5f;
+		}
+	}
+	REQUIRE(round_trip);
+
+	// every face the color of its index
+	constexpr int size = 4;
+	std::vector<float> faces(6 * size * size);
+	for (size_t i = 0; i < faces.size(); ++i) {
+		faces[i] = static_cast<float>(i / (size * size));
+	}
+	const vml::cubemap_storage cube(size, vml::texel_format::r32f, faces.data());
+	const auto s = cube.bind({ vml::filter::bilinear, vml::wrap::repeat });
+	REQUIRE(cube.levels() == 3);
+	REQUIRE(textureSize(s, 1).x == 2);
+	REQUIRE(textureQueryLevels(s) == 3);
+
+	REQUIRE(textureLod(s, vec3(1.f, .1f, -.2f), 0.f).r == 0.f);
+	REQUIRE(textureLod(s, vec3(-1.f, .1f, -.2f), 0.f).r == 1.f);
+	REQUIRE(textureLod(s, vec3(.1f, 1.f, -.2f), 0.f).r == 2.f);
+	REQUIRE(textureLod(s, vec3(.1f, -1.f, -.2f), 0.f).r == 3.f);
+	REQUIRE(textureLod(s, vec3(.1f, -.2f, 1.f), 0.f).r == 4.f);
+	REQUIRE(textureLod(s, vec3(.1f, -.2f, -1.f), 0.f).r == 5.f);
+	REQUIRE(textureLod(cube.bind({ vml::filter::nearest }), vec3(.1f, -.2f, -1.f), 2.f).r == 5.f); // no mixing in the mips
+
+	// seamless: right on the edge between +x and +z half of each, no wrap of +x onto itself
+	REQUIRE(textureLod(s, vec3(1.f, .1f, 1.f), 0.f).r == Approx(2.f));
+	REQUIRE(textureLod(s, vec3(1.f, .1f, .99f), 0.f).r > 0.f);
+	REQUIRE(textureLod(s, vec3(1.f, .1f, .99f), 0.f).r < 2.f);
+
+	// nothing bound
+	REQUIRE(texture(vml::samplerCube(), vec3(1.f)).a == 0.f);
+}
+
+TEST_CASE("tileable noise")
+{
+	constexpr int period = 4;
+	auto rng = vml::rng::seed(4u, 5u, 6u);
+	bool tiles = true, in_range = true;
+	for (int i = 0; i < 64; ++i) {
+		const vec3 p = vml::rng::next_vec3(rng) * static_cast<float>(period);
+		for (const vec3 shift : { vec3(period, 0.f, 0.f), vec3(0.f, -period, 0.f), vec3(0.f, 0.f, 2.f * period) }) {
+			tiles &= std::fabs(vml::noise::perlin(p, period) - vml::noise::perlin(p + shift, period)) < 1e-4f;
+			tiles &= std::fabs(vml::noise::worley(p, period) - vml::noise::worley(p + shift, period)) < 1e-4f;
+			tiles &= std::fabs(vml::noise::perlin_fbm(p, period, 4) - vml::noise::perlin_fbm(p + shift, period, 4)) < 1e-4f;
+			tiles &= std::fabs(vml::noise::worley_fbm(p, period, 3) - vml::noise::worley_fbm(p + shift, period, 3)) < 1e-4f;
+		}
+		const float f = vml::noise::perlin_fbm(p, period, 4), w = vml::noise::worley_fbm(p, period, 3);
+		in_range &= f >= 0.f && f <= 1.f && w >= 0.f && w <= 1.f;
+	}
+	REQUIRE(tiles);
+	REQUIRE(in_range);
+
+	REQUIRE(vml::noise::perlin(vec3(1.f, 2.f, 3.f), period) == 0.f);
+	REQUIRE(vml::noise::perlin(vec3(1.5f, 2.5f, 3.5f), period) != vml::noise::perlin(vec3(1.5f, 2.5f, 3.5f), period, 1u));
+}
+
+TEST_CASE("texture layouts")
+{
+	REQUIRE(vml::detail::sampling::spread_bits(0xbu) == 0x45u);
+
+	// odd sizes so the tiles and powers of 2 get padded, every layout has to read the same
+	constexpr int width = 37, height = 21;
+	std::vector<float> texels(width * height);
+	for (size_t i = 0; i < texels.size(); ++i) {
+		texels[i] = vml::rng::to_float(vml::rng::pcg(static_cast<uint32_t>(i)));
+	}
+	const vml::texture_storage<2> linear({ width, height }, vml::texel_format::r32f, texels.data());
+	const auto reference = linear.bind({ vml::filter::trilinear, vml::wrap::mirror });
+
+	for (auto layout : { vml::texture_layout::tiled_4x4, vml::texture_layout::tiled_8x8, vml::texture_layout::morton }) {
+		const vml::texture_storage<2> tex({ width, height }, vml::texel_format::r32f, texels.data(), true, layout);
+		const auto s = tex.bind({ vml::filter::trilinear, vml::wrap::mirror });
+		REQUIRE(tex.levels() == linear.levels());
+
+		bool same = true;
+		auto rng = vml::rng::seed(static_cast<uint32_t>(layout), 0, 0);
+		for (int i = 0; i < 256; ++i) {
+			const vec3 r = vml::rng::next_vec3(rng);
+			const vec2 uv = r.xy * 3.f - 1.f;
+			const float lod = r.z * tex.levels();
+			same &= textureLod(s, uv, lod).r == textureLod(reference, uv, lod).r;
+			const ivec2 p = ivec2(static_cast<int>(r.x * width), static_cast<int>(r.y * height));
+			same &= texelFetch(s, p, 0).r == texelFetch(reference, p, 0).r;
+		}
+		REQUIRE(same);
+	}
+}
+
+TEST_CASE("std140 std430 layout")
+{
+	using std140 = vml::std140_block<float, vec2, vec3, float[2], mat2, mat3>;
+	static_assert(std140::offset(0) == 0, "float");
+	static_assert(std140::offset(1) == 8, "vec2");
+	static_assert(std140::offset(2) == 16, "vec3");
+	static_assert(std140::offset(3) == 32, "float[2]");
+	static_assert(std140::offset(4) == 64, "mat2");
+	static_assert(std140::offset(5) == 96, "mat3");
+	static_assert(std140::size() == 144, "block");
+
+	using std430 = vml::std430_block<float, vec2, vec3, float[2], mat2, mat3>;
+	static_assert(std430::offset(3) == 28, "float[2] packs after vec3");
+	static_assert(std430::offset(4) == 40, "mat2");
+	static_assert(std430::offset(5) == 64, "mat3");
+
+	static_assert(vml::std140_block<vec3, float>::offset(1) == 12, "scalar packs after vec3");
+
+	struct push_k_t
+	{
+		vml::std430<vec4> light_direction;
+		vml::std430<mat4> view_matrix;
+	};
+	static_assert(offsetof(push_k_t, view_matrix) == vml::std430_block<vec4, mat4>::offset(1), "push constant");
+	static_assert(sizeof(push_k_t) == vml::std430_block<vec4, mat4>::size(), "push constant");
+
+	struct ubo_t
+	{
+		vml::std140<float> time;
+		vml::std140<vec3> position;
+		vml::std140<float[2]> weights;
+		vml::std140<mat3> rotation;
+	};
+	using ubo = vml::std140_block<float, vec3, float[2], mat3>;
+	static_assert(offsetof(ubo_t, position) == ubo::offset(1), "ubo");
+	static_assert(offsetof(ubo_t, weights) == ubo::offset(2), "ubo");
+	static_assert(offsetof(ubo_t, rotation) == ubo::offset(3), "ubo");
+	static_assert(sizeof(ubo_t) == ubo::size(), "ubo");
+
+	SECTION("read back from raw bytes") {
+		float raw[ubo::size() / sizeof(float)] = {};
+		raw[0] = 1.f;
+		raw[4] = 2.f; raw[5] = 3.f; raw[6] = 4.f;
+		raw[8] = 5.f; raw[12] = 6.f; // array elements are 16 bytes apart
+		raw[16 + 4] = 7.f; // second column of the mat3 starts at 16 bytes
+		const auto &u = *reinterpret_cast<const ubo_t *>(raw);
+
+		REQUIRE(float(u.time) == Approx(1.f));
+		REQUIRE(u.position->y == Approx(3.f));
+		REQUIRE(u.weights[0] == Approx(5.f));
+		REQUIRE(u.weights[1] == Approx(6.f));
+		mat3 m = u.rotation;
+		REQUIRE(m[1].x == Approx(7.f));
+	}
+
+	SECTION("write matrix") {
+		vml::std140<mat2> m = mat2(1.f, 2.f, 3.f, 4.f);
+		static_assert(sizeof(m) == 32, "mat2 columns are vec4 aligned in std140");
+		const auto *raw = reinterpret_cast<const float *>(&m);
+		REQUIRE(raw[0] == Approx(1.f));
+		REQUIRE(raw[1] == Approx(2.f));
+		REQUIRE(raw[4] == Approx(3.f));
+		REQUIRE(raw[5] == Approx(4.f));
+	}
+}
+
+// the bytes as a file of their own decoded by a loader, without mipmaps so level 0 is all there is
+std::shared_ptr<vml::render::texture_file> decode_bytes(const std::vector<uint8_t> &bytes, const char *extension)
+{
+	static int files = 0;
+	const std::string path = "test_advanced_" + std::to_string(files++) + extension;
+	FILE *f = fopen(path.c_str(), "wb");
+	REQUIRE(f);
+	fwrite(bytes.data(), 1, bytes.size(), f);
+	fclose(f);
+
+	vml::render::texture_options options;
+	options.mipmaps = false;
+	vml::render::texture_loader loader;
+	auto file = loader.load(path.c_str(), options);
+	file->ok(); // waits for the decode
+	remove(path.c_str());
+	return file;
+}
+
+std::vector<uint8_t> bytes_of(const std::string &header, std::initializer_list<int> body = {})
+{
+	std::vector<uint8_t> bytes(header.begin(), header.end());
+	bytes.insert(bytes.end(), body.begin(), body.end());
+	return bytes;
+}
+
+void append_float(std::vector<uint8_t> &bytes, float value, bool big_endian)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for (int i = 0; i < 4; ++i) {
+		bytes.push_back(static_cast<uint8_t>(bits >> (big_endian ? 24 - 8 * i : 8 * i)));
+	}
+}
+
+// row 0 the bottom
+bool texel_is(const vml::render::texture_file &file, int x, int y, float r, float g, float b, float a)
+{
+	const auto &level = file.channel().levels[0];
+	const auto *texel = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(level.texels) + y * level.pitch[0]) + 4 * x;
+	const float expected[4] = { r, g, b, a };
+	for (int c = 0; c < 4; ++c) {
+		if (std::fabs(texel[c] - expected[c]) > 1e-6f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool rgba8_is(const vml::render::texture_file &file, int x, int y, int r, int g, int b, int a = 255)
+{
+	return texel_is(file, x, y, r / 255.f, g / 255.f, b / 255.f, a / 255.f);
+}
+
+bool fails_with(const vml::render::texture_file &file, const char *what)
+{
+	return !file.ok() && std::string(file.error()).find(what) != std::string::npos && file.channel().levels == nullptr;
+}
+
+TEST_CASE("texture file decoders")
+{
+	SECTION("PPM") {
+		// 8 bits rgb, the top row first, comments in the header
+		auto rgb = decode_bytes(bytes_of("P6\n# comment\n2 2\n255\n", {
+			255, 0, 0,  0, 255, 0,
+			0, 0, 255,  51, 102, 153 }), ".ppm");
+		REQUIRE(rgb->ok());
+		REQUIRE(rgb->width() == 2);
+		REQUIRE(rgb->height() == 2);
+		REQUIRE(rgba8_is(*rgb, 0, 1, 255, 0, 0));
+		REQUIRE(rgba8_is(*rgb, 1, 1, 0, 255, 0));
+		REQUIRE(rgba8_is(*rgb, 0, 0, 0, 0, 255));
+		REQUIRE(rgba8_is(*rgb, 1, 0, 51, 102, 153));
+
+		// 16 bits grey, big endian
+		auto grey = decode_bytes(bytes_of("P5 2 1 65535\n", { 0xff, 0xff, 0x80, 0x00 }), ".pgm");
+		REQUIRE(grey->ok());
+		REQUIRE(texel_is(*grey, 0, 0, 1.f, 1.f, 1.f, 1.f));
+		const float half = 0x8000 / 65535.f;
+		REQUIRE(texel_is(*grey, 1, 0, half, half, half, 1.f));
+
+		// a maxval other than 255 scales to it
+		auto ten = decode_bytes(bytes_of("P5 1 1 10\n", { 5 }), ".pgm");
+		REQUIRE(texel_is(*ten, 0, 0, .5f, .5f, .5f, 1.f));
+	}
+
+	SECTION("PFM") {
+		// the bottom row first, the sign of the scale is the endianness and its size is ignored
+		for (const bool big_endian : { false, true }) {
+			auto bytes = bytes_of(big_endian ? "PF\n1 2\n1.0\n" : "PF\n1 2\n-2.0\n");
+			for (const float value : { .25f, -1.5f, 3.f, 100.f, 0.f, 1e-3f }) {
+				append_float(bytes, value, big_endian);
+			}
+			auto file = decode_bytes(bytes, ".pfm");
+			REQUIRE(file->ok());
+			REQUIRE(texel_is(*file, 0, 0, .25f, -1.5f, 3.f, 1.f));
+			REQUIRE(texel_is(*file, 0, 1, 100.f, 0.f, 1e-3f, 1.f));
+		}
+
+		auto grey_bytes = bytes_of("Pf 2 1 -1\n");
+		append_float(grey_bytes, .5f, false);
+		append_float(grey_bytes, 8.f, false);
+		auto grey = decode_bytes(grey_bytes, ".pfm");
+		REQUIRE(grey->ok());
+		REQUIRE(texel_is(*grey, 0, 0, .5f, .5f, .5f, 1.f));
+		REQUIRE(texel_is(*grey, 1, 0, 8.f, 8.f, 8.f, 1.f));
+	}
+
+	SECTION("TGA") {
+		// type, width, height, bits per pixel and descriptor of an 18 byte header without an image id
+		auto header = [](int type, int width, int height, int bpp, int descriptor)
+		{
+			return std::vector<uint8_t> { 0, 0, static_cast<uint8_t>(type), 0, 0, 0, 0, 0, 0, 0, 0, 0,
+				static_cast<uint8_t>(width), static_cast<uint8_t>(width >> 8),
+				static_cast<uint8_t>(height), static_cast<uint8_t>(height >> 8),
+				static_cast<uint8_t>(bpp), static_cast<uint8_t>(descriptor) };
+		};
+
+		// raw BGR, the bottom row first
+		auto raw_bytes = header(2, 2, 2, 24, 0);
+		raw_bytes.insert(raw_bytes.end(), { 0, 0, 255,  0, 255, 0,  255, 0, 0,  30, 20, 10 });
+		auto raw = decode_bytes(raw_bytes, ".tga");
+		REQUIRE(raw->ok());
+		REQUIRE(rgba8_is(*raw, 0, 0, 255, 0, 0));
+		REQUIRE(rgba8_is(*raw, 1, 0, 0, 255, 0));
+		REQUIRE(rgba8_is(*raw, 0, 1, 0, 0, 255));
+		REQUIRE(rgba8_is(*raw, 1, 1, 10, 20, 30));
+
+		// same, the top row first
+		raw_bytes[17] = 0x20;
+		auto top_down = decode_bytes(raw_bytes, ".tga");
+		REQUIRE(top_down->ok());
+		REQUIRE(rgba8_is(*top_down, 0, 1, 255, 0, 0));
+		REQUIRE(rgba8_is(*top_down, 1, 1, 0, 255, 0));
+		REQUIRE(rgba8_is(*top_down, 0, 0, 0, 0, 255));
+		REQUIRE(rgba8_is(*top_down, 1, 0, 10, 20, 30));
+
+		// RLE BGRA: a run of 3 then a raw packet of 1, a run going past the last pixel stops there
+		auto rle_bytes = header(10, 2, 2, 32, 0);
+		rle_bytes.insert(rle_bytes.end(), { 0x82, 1, 2, 3, 4,  0x00, 5, 6, 7, 8 });
+		auto rle = decode_bytes(rle_bytes, ".tga");
+		REQUIRE(rle->ok());
+		REQUIRE(rgba8_is(*rle, 0, 0, 3, 2, 1, 4));
+		REQUIRE(rgba8_is(*rle, 1, 0, 3, 2, 1, 4));
+		REQUIRE(rgba8_is(*rle, 0, 1, 3, 2, 1, 4));
+		REQUIRE(rgba8_is(*rle, 1, 1, 7, 6, 5, 8));
+
+		auto grey_bytes = header(11, 3, 1, 8, 0);
+		grey_bytes.insert(grey_bytes.end(), { 0x81, 51,  0x00, 255 });
+		auto grey = decode_bytes(grey_bytes, ".tga");
+		REQUIRE(grey->ok());
+		REQUIRE(rgba8_is(*grey, 1, 0, 51, 51, 51));
+		REQUIRE(rgba8_is(*grey, 2, 0, 255, 255, 255));
+	}
+
+	SECTION("QOI") {
+		// 4x2 rgba, every op once or more
+		auto file = decode_bytes(bytes_of("qoif", { 0, 0, 0, 4,  0, 0, 0, 2,  4, 0,
+			0xfe, 10, 20, 30,			// rgb
+			0xc1,						// run of 2
+			0x76,						// diff: r + 1, g - 1
+			0xa5, 0x6a,					// luma: g + 5, r + 3, b + 7
+			0x09,						// index of 10, 20, 30, 255
+			0xff, 1, 2, 3, 4,			// rgba
+			0x07,						// index of 11, 19, 30, 255
+			0, 0, 0, 0, 0, 0, 0, 1 }), ".qoi");
+		REQUIRE(file->ok());
+		REQUIRE(file->width() == 4);
+		REQUIRE(file->height() == 2);
+		REQUIRE(rgba8_is(*file, 0, 1, 10, 20, 30));
+		REQUIRE(rgba8_is(*file, 1, 1, 10, 20, 30));
+		REQUIRE(rgba8_is(*file, 2, 1, 10, 20, 30));
+		REQUIRE(rgba8_is(*file, 3, 1, 11, 19, 30));
+		REQUIRE(rgba8_is(*file, 0, 0, 14, 24, 37));
+		REQUIRE(rgba8_is(*file, 1, 0, 10, 20, 30));
+		REQUIRE(rgba8_is(*file, 2, 0, 1, 2, 3, 4));
+		REQUIRE(rgba8_is(*file, 3, 0, 11, 19, 30));
+	}
+
+	SECTION("broken files fail cleanly") {
+		REQUIRE(fails_with(*decode_bytes(bytes_of("P6 2 2 255\n", { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }), ".ppm"), "truncated PPM"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("P6 40000 1 255\n", { 1, 2, 3 }), ".ppm"), "bad PPM header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("P5 1 1 0\n", { 1 }), ".pgm"), "bad PPM header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("P5 -1 1 255\n", { 1 }), ".pgm"), "bad PPM header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("P6 1"), ".ppm"), "bad PPM header"));
+
+		REQUIRE(fails_with(*decode_bytes(bytes_of("PF 1 1 -1\n", { 0, 0, 0, 0 }), ".pfm"), "truncated PFM"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("Pf 1 0 -1\n", { 0, 0, 0, 0 }), ".pfm"), "bad PFM header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("Pf 1 1"), ".pfm"), "bad PFM header"));
+
+		REQUIRE(fails_with(*decode_bytes({ 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0 }, ".tga"), "truncated TGA"));
+		REQUIRE(fails_with(*decode_bytes({ 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 24, 0, 1, 2 }, ".tga"), "truncated TGA"));
+		REQUIRE(fails_with(*decode_bytes({ 0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 1, 0, 24, 0, 0x00, 1, 2, 3, 0x80, 1 }, ".tga"),
+			"truncated TGA"));
+		REQUIRE(fails_with(*decode_bytes({ 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 1, 0, 24, 0, 1, 2, 3 }, ".tga"),
+			"bad TGA header"));
+		REQUIRE(fails_with(*decode_bytes({ 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 8, 0, 0 }, ".tga"), "unsupported TGA"));
+		REQUIRE(fails_with(*decode_bytes({ 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 16, 0, 0, 0 }, ".tga"), "unsupported TGA"));
+
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0, 0, 0, 1,  0, 0, 0, 1 }), ".qoi"), "truncated QOI"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0, 0, 0, 2,  0, 0, 0, 1,  4, 0,  0xfe, 1, 2 }), ".qoi"), "truncated QOI"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0, 0, 0, 2,  0, 0, 0, 1,  4, 0,  0xfe, 1, 2, 3 }), ".qoi"), "truncated QOI"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0xff, 0xff, 0xff, 0xff,  0, 0, 0, 1,  4, 0 }), ".qoi"), "bad QOI header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0, 1, 0, 0,  0, 0, 0, 1,  4, 0 }), ".qoi"), "bad QOI header"));
+		REQUIRE(fails_with(*decode_bytes(bytes_of("qoif", { 0, 0, 0, 0,  0, 0, 0, 1,  4, 0 }), ".qoi"), "bad QOI header"));
+
+		REQUIRE(fails_with(*decode_bytes(bytes_of("GIF89a"), ".gif"), "unknown format"));
+		REQUIRE(fails_with(*decode_bytes({}, ".ppm"), "can't be read"));
+	}
+}
+
+TEST_CASE("tile scheduler")
+{
+	// odd sizes so the last tiles of a row and of a column are cut short
+	constexpr int width = 101, height = 37;
+	for (const int threads : { 1, 4 }) {
+		for (const int tile_height : { 4, 1 }) {
+			vml::render::tile_scheduler scheduler(threads, tile_height == 1 ? width : 8, tile_height, false);
+			REQUIRE(scheduler.threads() == threads);
+
+			std::vector<std::atomic<int>> shaded(width * height);
+			std::atomic<bool> inside { true };
+			for (int frame = 0; frame < 3; ++frame) {
+				// the top tiles are slow so the workers that started on the bottom ones steal them
+				scheduler.run(width, height, [&](const vml::render::tile &t)
+				{
+					if (t.x_begin < 0 || t.y_begin < 0 || t.x_end > width || t.y_end > height
+						|| t.x_begin >= t.x_end || t.y_begin >= t.y_end) {
+						inside = false;
+					}
+					if (t.y_begin < height / 4) {
+						std::this_thread::sleep_for(std::chrono::microseconds(200));
+					}
+					for (int y = t.y_begin; y < t.y_end; ++y) {
+						for (int x = t.x_begin; x < t.x_end; ++x) {
+							++shaded[y * width + x];
+						}
+					}
+				});
+			}
+
+			REQUIRE(inside);
+			bool once_a_frame = true;
+			for (const auto &count : shaded) {
+				once_a_frame = once_a_frame && count == 3;
+			}
+			REQUIRE(once_a_frame);
+			if (threads == 1) {
+				REQUIRE(scheduler.steals() == 0);
+			}
+		}
+	}
+
+	// nothing to shade
+	vml::render::tile_scheduler scheduler(2, 32, 8, false);
+	int tiles = 0;
+	scheduler.run(0, 10, [&tiles](const vml::render::tile &) { ++tiles; });
+	REQUIRE(tiles == 0);
+}
+
+TEST_CASE("thread pool")
+{
+	for (const int threads : { 1, 3, 8 }) {
+		vml::render::thread_pool pool(threads, false);
+		REQUIRE(pool.threads() == threads);
+
+		std::vector<std::atomic<int>> calls(threads);
+		for (int run = 0; run < 200; ++run) {
+			pool.run([&calls](int worker) { ++calls[worker]; });
+
+			// run() only returns once every worker is done with this run
+			bool all = true;
+			for (const auto &count : calls) {
+				all = all && count == run + 1;
+			}
+			REQUIRE(all);
+		}
+		REQUIRE(pool.stats().total >= 0.f);
+		REQUIRE(pool.pinned() == 0);
+	}
+
+	// a lone pool pins at most one worker per allowed CPU, a second one doesn't pin at all
+	vml::render::thread_pool first(2);
+	REQUIRE(first.pinned() <= 1);
+	vml::render::thread_pool second(2);
+	REQUIRE(second.pinned() == 0);
+	vml::render::thread_pool oversubscribed(4 * std::max(1u, std::thread::hardware_concurrency()));
+	REQUIRE(oversubscribed.pinned() == 0);
+
+	std::atomic<int> calls { 0 };
+	first.run([&calls](int) { ++calls; });
+	second.run([&calls](int) { ++calls; });
+	REQUIRE(calls == 4);
+}
+
+// a shader for the render layer, on rgba32f: the image pass writes iFrame in r, counts in g how often
+// a pixel was shaded and copies iChannel1 in b; buffer A adds one to what iChannel0 (itself) had there,
+// buffer B adds iChannel0 (A) to what iChannel1 (itself) had
+float channel_at(const kernel::shade_job &job, int channel, int x, int y)
+{
+	if (!job.channels || !job.channels[channel].levels) {
+		return 0.f;
+	}
+	const auto &level = job.channels[channel].levels[0];
+	const auto *row = reinterpret_cast<const uint8_t*>(level.texels) + (level.size[1] - 1 - y) * level.pitch[0];
+	return reinterpret_cast<const float*>(row)[4 * x];
+}
+
+void counting_shade_rect(const kernel::shade_job &job)
+{
+	for (int y = job.y_begin; y < job.y_end; ++y) {
+		float *row = reinterpret_cast<float*>(static_cast<uint8_t*>(job.pixels) + y * job.pitch);
+		for (int x = job.x_begin; x < job.x_end; ++x) {
+			float *pixel = row + 4 * x;
+			if (job.pass == kernel::shader_pass::buffer_a) {
+				pixel[0] = channel_at(job, 0, x, y) + 1.f;
+			} else if (job.pass == kernel::shader_pass::buffer_b) {
+				pixel[0] = channel_at(job, 0, x, y) + channel_at(job, 1, x, y);
+			} else {
+				pixel[0] = static_cast<float>(job.inputs->frame);
+				pixel[1] += 1.f;
+				pixel[2] = channel_at(job, 1, x, y);
+			}
+		}
+	}
+}
+
+const float* pixel_at(const vml::render::framebuffer &fb, int x, int y)
+{
+	return reinterpret_cast<const float*>(static_cast<const uint8_t*>(fb.pixels) + y * fb.pitch) + 4 * x;
+}
+
+TEST_CASE("headless shading")
+{
+	constexpr int width = 33, height = 17;
+	const auto &shader = kernel::select();
+	vml::render::tile_scheduler scheduler(3, 8, 4, false);
+	vml::render::uniforms u = {};
+	u.time = 1.5f;
+
+	vml::render::image hdr(width, height, vml::render::format::rgba32f);
+	vml::render::image rgb(width, height, vml::render::format::rgb8);
+	vml::render::image rgba(width, height, vml::render::format::rgba8);
+	shade(shader, hdr.view(), u, scheduler);
+	shade(shader, rgb.view(), u, scheduler);
+	shade(shader, rgba.view(), u, scheduler);
+
+	// caller owned rows with padding after them, the padding is left alone
+	constexpr int pitch = width * 3 + 5;
+	std::vector<uint8_t> owned(pitch * height, 0xab);
+	shade(shader, { owned.data(), width, height, pitch, vml::render::format::rgb8 }, u, scheduler);
+
+	// the same picture in every format, the 8-bit ones clamped
+	bool same = true, padded = true, flat = true;
+	const auto hdr_fb = hdr.view(), rgb_fb = rgb.view(), rgba_fb = rgba.view();
+	for (int y = 0; y < height; ++y) {
+		const auto *rgb_row = static_cast<const uint8_t*>(rgb_fb.pixels) + y * rgb_fb.pitch;
+		const auto *rgba_row = static_cast<const uint8_t*>(rgba_fb.pixels) + y * rgba_fb.pitch;
+		const auto *owned_row = owned.data() + y * pitch;
+		for (int x = 0; x < width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				const float f = std::min(std::max(pixel_at(hdr_fb, x, y)[c], 0.f), 1.f) * 255;
+				same = same && std::fabs(rgb_row[3 * x + c] - f) <= 1.f && rgba_row[4 * x + c] == rgb_row[3 * x + c]
+					&& owned_row[3 * x + c] == rgb_row[3 * x + c];
+				flat = flat && rgb_row[3 * x + c] == *static_cast<const uint8_t*>(rgb_fb.pixels);
+			}
+		}
+		for (int b = width * 3; b < pitch; ++b) {
+			padded = padded && owned_row[b] == 0xab;
+		}
+	}
+	REQUIRE_FALSE(flat);
+	REQUIRE(same);
+	REQUIRE(padded);
+
+	// only a rect of the frame
+	const kernel::shader_traits traits = {};
+	const kernel::entry_points counting = { "counting", "test", &traits, counting_shade_rect };
+	const auto counts = hdr.view();
+	for (int y = 0; y < height; ++y) {
+		memset(static_cast<uint8_t*>(counts.pixels) + y * counts.pitch, 0, width * 16);
+	}
+	shade(counting, counts, u, scheduler, vml::render::tile { 3, 2, 20, 9 });
+	bool in_rect = true;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			in_rect = in_rect && pixel_at(counts, x, y)[1] == (x >= 3 && x < 20 && y >= 2 && y < 9 ? 1.f : 0.f);
+		}
+	}
+	REQUIRE(in_rect);
+}
+
+TEST_CASE("frame cache")
+{
+	const kernel::shader_traits still = { true, 2.f, 0, false };
+	const kernel::entry_points shader = { "counting", "test", &still, counting_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 32, 8, false);
+	vml::render::image img(40, 30, vml::render::format::rgba32f);
+	const auto fb = img.view();
+
+	// how many pixels were shaded n times so far
+	auto shaded = [&fb](float n)
+	{
+		int count = 0;
+		for (int y = 0; y < fb.height; ++y) {
+			for (int x = 0; x < fb.width; ++x) {
+				count += pixel_at(fb, x, y)[1] == n;
+			}
+		}
+		return count;
+	};
+
+	vml::render::frame_cache cache(shader);
+	vml::render::uniforms u = {};
+	REQUIRE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() == 1.f);
+	REQUIRE(shaded(1) == 40 * 30);
+
+	// nothing to redraw: the same uniforms, and the clock for a time invariant shader
+	REQUIRE_FALSE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() == 0.f);
+	u.time = 1.f;
+	u.frame = 1;
+	REQUIRE_FALSE(cache.render(fb, u, scheduler));
+	REQUIRE(shaded(1) == 40 * 30);
+
+	// the mouse moves from (0, 0) to (10, 20): a dirty rect around each, row 0 the top
+	u.mouse[0] = 10.f;
+	u.mouse[1] = 20.f;
+	u.mouse[2] = -10.f;
+	u.mouse[3] = -20.f;
+	REQUIRE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() > 0.f);
+	REQUIRE(cache.shaded() < .1f);
+	REQUIRE(shaded(2) == static_cast<int>(cache.shaded() * 40 * 30 + .5f));
+	REQUIRE(pixel_at(fb, 10, 30 - 1 - 20)[1] == 2.f);
+	REQUIRE(pixel_at(fb, 0, 30 - 1)[1] == 2.f);
+	REQUIRE(pixel_at(fb, 25, 5)[1] == 1.f);
+	REQUIRE_FALSE(cache.render(fb, u, scheduler));
+
+	// a rect of its own, clipped to the frame
+	const int twice = shaded(2);
+	cache.invalidate({ 35, 25, 50, 50 });
+	REQUIRE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() == 5 * 5 / (40 * 30.f));
+	REQUIRE(shaded(2) == twice + 5 * 5);
+	REQUIRE(pixel_at(fb, 39, 29)[1] == 2.f);
+	REQUIRE(pixel_at(fb, 34, 29)[1] == 1.f);
+
+	// everything once the clock matters
+	const kernel::shader_traits animated = { false, 2.f, 0, false };
+	const kernel::entry_points clocked = { "counting", "test", &animated, counting_shade_rect };
+	cache.shader(clocked);
+	REQUIRE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() == 1.f);
+	REQUIRE_FALSE(cache.render(fb, u, scheduler));
+	u.time = 2.f;
+	REQUIRE(cache.render(fb, u, scheduler));
+	REQUIRE(cache.shaded() == 1.f);
+	REQUIRE(pixel_at(fb, 25, 5)[1] == 3.f);
+}
+
+TEST_CASE("frame pipeline")
+{
+	const kernel::shader_traits traits = {};
+	const kernel::entry_points shader = { "counting", "test", &traits, counting_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 32, 8, false);
+	for (const int depth : { 2, 3 }) {
+		vml::render::frame_pipeline pipeline(16, 4, vml::render::format::rgba32f, depth,
+			[&](const vml::render::framebuffer &fb, const vml::render::uniforms &u) { shade(shader, fb, u, scheduler); });
+
+		// presented in the order they were shaded, none skipped
+		bool in_order = true;
+		for (int frame = 0; frame < 20; ++frame) {
+			const auto &fb = *pipeline.acquire();
+			in_order = in_order && pixel_at(fb, 0, 0)[0] == frame && pixel_at(fb, 15, 3)[0] == frame;
+			pipeline.release();
+		}
+		REQUIRE(in_order);
+	}
+}
+
+TEST_CASE("multipass buffers")
+{
+	const kernel::shader_traits traits = { false, 0.f, 2, false };
+	const kernel::entry_points shader = { "counting", "test", &traits, counting_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 4, 2, false);
+	vml::render::image img(6, 4, vml::render::format::rgba32f);
+	const auto out = img.view();
+
+	vml::render::multipass_renderer passes(shader);
+	REQUIRE(passes.buffers() == 2);
+	REQUIRE(passes.cubemap() == nullptr);
+
+	// channel c of every pixel of the framebuffer, or -1 if they are not all the same
+	auto value = [](const vml::render::framebuffer &fb, int c)
+	{
+		const float first = pixel_at(fb, 0, 0)[c];
+		for (int y = 0; y < fb.height; ++y) {
+			for (int x = 0; x < fb.width; ++x) {
+				if (pixel_at(fb, x, y)[c] != first) {
+					return -1.f;
+				}
+			}
+		}
+		return first;
+	};
+
+	// a buffer reads its own last frame, the ones after it this frame's: A counts the frames, B sums A
+	vml::render::uniforms u = {};
+	for (u.frame = 0; u.frame < 4; ++u.frame) {
+		passes.render(out, u, scheduler);
+		const float n = u.frame + 1.f;
+		REQUIRE(value(passes.buffer(0), 0) == n);
+		REQUIRE(value(passes.buffer(1), 0) == n * (n + 1) / 2);
+		REQUIRE(value(out, 0) == u.frame);
+		REQUIRE(value(out, 2) == n * (n + 1) / 2);
+	}
+
+	// back to all zero buffers
+	passes.reset();
+	passes.render(out, u, scheduler);
+	REQUIRE(value(passes.buffer(0), 0) == 1.f);
+	REQUIRE(value(passes.buffer(1), 0) == 1.f);
+	passes.render(out, u, scheduler);
+	REQUIRE(value(passes.buffer(1), 0) == 3.f);
+
+	// and so does another size
+	vml::render::image smaller(5, 3, vml::render::format::rgba32f);
+	passes.render(smaller.view(), u, scheduler);
+	REQUIRE(passes.buffer(0).width == 5);
+	REQUIRE(value(passes.buffer(0), 0) == 1.f);
+	REQUIRE(value(passes.buffer(1), 0) == 1.f);
+
+	// the image pass reading A as iChannel1, B reading nothing there
+	passes.bind(kernel::shader_pass::image, 1, 0);
+	passes.bind(kernel::shader_pass::buffer_b, 1, 7);
+	passes.render(smaller.view(), u, scheduler);
+	REQUIRE(value(passes.buffer(0), 0) == 2.f);
+	REQUIRE(value(passes.buffer(1), 0) == 2.f);
+	REQUIRE(value(smaller.view(), 2) == 2.f);
+}
+
+TEST_CASE("video")
+{
+	// a grey of 40 * iFrame, the earlier frames take longer so the workers finish them out of order
+	std::atomic<int> calls { 0 };
+	auto grey = [&calls](const vml::render::framebuffer &fb, const vml::render::uniforms &u, vml::render::tile_scheduler &)
+	{
+		++calls;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2 * (8 - u.frame)));
+		for (int y = 0; y < fb.height; ++y) {
+			memset(static_cast<uint8_t*>(fb.pixels) + y * fb.pitch, 40 * u.frame, fb.width * 3);
+		}
+	};
+
+	// the whole stream render() wrote
+	auto render = [](vml::render::video_renderer &video)
+	{
+		FILE *f = tmpfile();
+		REQUIRE(f);
+		REQUIRE(video.render(f, {}));
+		std::vector<uint8_t> bytes(static_cast<size_t>(ftell(f)));
+		rewind(f);
+		REQUIRE(fread(bytes.data(), 1, bytes.size(), f) == bytes.size());
+		fclose(f);
+		return bytes;
+	};
+
+	vml::render::video_options options;
+	options.first = 2;
+	options.last = 5;
+	options.fps_num = 30;
+	options.threads = 3;
+	options.depth = 3;
+
+	SECTION("Y4M") {
+		// odd sizes: the chroma planes round up, 3x2 for 5x3
+		vml::render::video_renderer video(5, 3, options, grey);
+		const auto bytes = render(video);
+		const std::string header = "YUV4MPEG2 W5 H3 F30:1 Ip A1:1 C420jpeg\n";
+		const size_t luma = 5 * 3, chroma = 3 * 2, frame = 6 + luma + 2 * chroma;
+		REQUIRE(bytes.size() == header.size() + 4 * frame);
+		REQUIRE(std::string(bytes.begin(), bytes.begin() + header.size()) == header);
+
+		int last = -1;
+		bool planes = true;
+		for (int i = 0; i < 4; ++i) {
+			const uint8_t *f = bytes.data() + header.size() + i * frame;
+			planes = planes && memcmp(f, "FRAME\n", 6) == 0;
+			for (size_t b = 1; b < luma; ++b) {
+				planes = planes && f[6 + b] == f[6];
+			}
+			for (size_t b = 0; b < 2 * chroma; ++b) {
+				planes = planes && f[6 + luma + b] == 128;	// grey has no chroma
+			}
+			planes = planes && f[6] > last;	// brighter every frame, so in order
+			last = f[6];
+		}
+		REQUIRE(planes);
+		REQUIRE(video.stats().frames == 4);
+		REQUIRE(calls == 4);
+	}
+
+	SECTION("rgb24 in order") {
+		options.format = vml::render::video_format::rgb24;
+		vml::render::video_renderer video(5, 3, options, grey);
+		const auto bytes = render(video);
+		REQUIRE(bytes.size() == 4 * 5 * 3 * 3);
+		bool in_order = true;
+		for (size_t b = 0; b < bytes.size(); ++b) {
+			in_order = in_order && bytes[b] == 40 * (options.first + static_cast<int>(b / (5 * 3 * 3)));
+		}
+		REQUIRE(in_order);
+	}
+
+	SECTION("sequential") {
+		// from frame 0 on, only first..last written
+		options.format = vml::render::video_format::rgb24;
+		options.sequential = true;
+		vml::render::video_renderer video(4, 1, options, grey);
+		const auto bytes = render(video);
+		REQUIRE(bytes.size() == 4 * 4 * 3);
+		REQUIRE(bytes.front() == 80);
+		REQUIRE(bytes.back() == 200);
+		REQUIRE(calls == 6);
+	}
+}
+
+// rgba32f, iTime / 10 on the right half and still on the left one, only the quads of the job's pattern
+void split_shade_rect(const kernel::shade_job &job)
+{
+	for (int y = job.y_begin; y < job.y_end; ++y) {
+		float *row = reinterpret_cast<float*>(static_cast<uint8_t*>(job.pixels) + y * job.pitch);
+		for (int x = job.x_begin; x < job.x_end; ++x) {
+			if (kernel::selected(job.pattern, job.phase, x / 2, y / 2)) {
+				const float value = x < job.width / 2 ? .25f : job.inputs->time / 10;
+				row[4 * x] = row[4 * x + 1] = row[4 * x + 2] = value;
+				row[4 * x + 3] = 1.f;
+			}
+		}
+	}
+}
+
+// the columns [x_begin, x_end) of fb all of that grey
+bool grey_is(const vml::render::framebuffer &fb, int x_begin, int x_end, float value)
+{
+	for (int y = 0; y < fb.height; ++y) {
+		for (int x = x_begin; x < x_end; ++x) {
+			const float *pixel = pixel_at(fb, x, y);
+			for (int c = 0; c < 3; ++c) {
+				if (std::fabs(pixel[c] - value) > 1e-6f) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+TEST_CASE("interleaved rendering")
+{
+	const kernel::shader_traits traits = {};
+	const kernel::entry_points shader = { "split", "test", &traits, split_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 4, 2, false);
+	vml::render::image img(16, 8, vml::render::format::rgba32f);
+	const auto out = img.view();
+
+	for (const auto pattern : { kernel::quad_pattern::checkerboard, kernel::quad_pattern::interleave_2x2 }) {
+		const float share = pattern == kernel::quad_pattern::checkerboard ? .5f : .25f;
+		vml::render::interleaved_renderer interleaved(shader, pattern);
+		vml::render::uniforms u = {};
+
+		// the first frame has no history to reuse
+		interleaved.render(out, u, scheduler);
+		REQUIRE(interleaved.shaded() == 1.f);
+		REQUIRE(grey_is(out, 0, 8, .25f));
+		REQUIRE(grey_is(out, 8, 16, 0.f));
+
+		// nothing moved: the rest reused as is
+		interleaved.render(out, u, scheduler);
+		REQUIRE(interleaved.shaded() == share);
+		REQUIRE(interleaved.reused() == 1.f - share);
+		REQUIRE(grey_is(out, 0, 8, .25f));
+		REQUIRE(grey_is(out, 8, 16, 0.f));
+
+		// the right half moved: interpolated there from this frame's quads, still reused away from it
+		u.time = 1.f;
+		interleaved.render(out, u, scheduler);
+		REQUIRE(interleaved.shaded() == share);
+		REQUIRE(interleaved.reused() > 0.f);
+		REQUIRE(interleaved.interpolated() > 0.f);
+		REQUIRE(grey_is(out, 0, 4, .25f));
+		REQUIRE(grey_is(out, 10, 16, .1f));
+
+		// iTime going back starts over
+		u.time = 0.f;
+		interleaved.render(out, u, scheduler);
+		REQUIRE(interleaved.shaded() == 1.f);
+		REQUIRE(grey_is(out, 8, 16, 0.f));
+	}
+}
+
+TEST_CASE("supersampling")
+{
+	const kernel::shader_traits traits = {};
+	const kernel::entry_points shader = { "split", "test", &traits, split_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 4, 2, false);
+	vml::render::image img(16, 8, vml::render::format::rgba32f);
+	const auto out = img.view();
+	vml::render::uniforms u = {};
+
+	REQUIRE(vml::render::supersampler::named("rooks") == kernel::sample_pattern::rooks);
+	REQUIRE(vml::render::supersampler::named("msaa") == kernel::sample_pattern::none);
+
+	// no threshold: every pixel gets the whole pattern
+	vml::render::supersampler all(shader, kernel::sample_pattern::rotated_grid);
+	all.render(out, u, scheduler);
+	REQUIRE(all.shaded() == 4.f);
+	REQUIRE(all.supersampled() == 1.f);
+	REQUIRE(grey_is(out, 0, 8, .25f));
+	REQUIRE(grey_is(out, 8, 16, 0.f));
+
+	// only the quads on either side of the edge between the halves, 2 of 8 columns
+	vml::render::supersampler edges(shader, kernel::sample_pattern::stratified, 1.f / 16);
+	edges.render(out, u, scheduler);
+	REQUIRE(edges.supersampled() == .25f);
+	REQUIRE(edges.shaded() == 1.f + .25f * 16);
+
+	// no edge once both halves are the same grey
+	u.time = 2.5f;
+	edges.render(out, u, scheduler);
+	REQUIRE(edges.supersampled() == 0.f);
+	REQUIRE(edges.shaded() == 1.f);
+	REQUIRE(grey_is(out, 0, 16, .25f));
+}
+
+// split_shade_rect that also keeps which columns were shaded at full rate, one bit each
+std::atomic<uint64_t> full_rate_columns { 0 };
+
+void split_columns_shade_rect(const kernel::shade_job &job)
+{
+	split_shade_rect(job);
+	if (job.step == 1) {
+		for (int x = job.x_begin; x < job.x_end; ++x) {
+			full_rate_columns |= uint64_t(1) << x;
+		}
+	}
+}
+
+// the bits of the columns [begin, end)
+uint64_t columns(int begin, int end)
+{
+	return ((uint64_t(1) << end) - 1) & ~((uint64_t(1) << begin) - 1);
+}
+
+TEST_CASE("adaptive shading")
+{
+	const kernel::shader_traits traits = {};
+	const kernel::entry_points shader = { "split", "test", &traits, split_columns_shade_rect };
+	vml::render::tile_scheduler scheduler(2, 4, 2, false);
+	vml::render::image img(32, 8, vml::render::format::rgba32f);
+	const auto out = img.view();
+	vml::render::uniforms u = {};
+
+	// 8 x 2 blocks of 4 pixels, 9 x 3 coarse samples, the edge is between the ones at 12 and 16
+	constexpr float coarse = 9 * 3, pixels = 32 * 8;
+	vml::render::adaptive_renderer adaptive(shader, 1.f / 1024, 4);
+	REQUIRE(adaptive.threshold() == 1.f / 1024);
+
+	// the blocks whose ring of samples crosses the edge are shaded at full rate, 3 of 8 columns, the rest interpolated
+	full_rate_columns = 0;
+	adaptive.render(out, u, scheduler);
+	REQUIRE(full_rate_columns == columns(8, 20));
+	REQUIRE(adaptive.refined() == 3.f / 8);
+	REQUIRE(adaptive.shaded() == (coarse + 3 * 4 * 8) / pixels);
+	REQUIRE(grey_is(out, 0, 16, .25f));
+	REQUIRE(grey_is(out, 16, 32, 0.f));
+
+	// a flat frame needs only the coarse pass
+	u.time = 2.5f;
+	full_rate_columns = 0;
+	adaptive.render(out, u, scheduler);
+	REQUIRE(full_rate_columns == 0);
+	REQUIRE(adaptive.refined() == 0.f);
+	REQUIRE(adaptive.shaded() == coarse / pixels);
+	REQUIRE(grey_is(out, 0, 32, .25f));
+
+	// the block straddling the edge varies the most (.0156 against .0117 either side of it)
+	u.time = 0.f;
+	adaptive.threshold(.013f);
+	full_rate_columns = 0;
+	adaptive.render(out, u, scheduler);
+	REQUIRE(full_rate_columns == columns(12, 16));
+	REQUIRE(adaptive.refined() == 1.f / 8);
+
+	// above any of them nothing is refined and the edge gets blurred
+	adaptive.threshold(1.f);
+	full_rate_columns = 0;
+	adaptive.render(out, u, scheduler);
+	REQUIRE(full_rate_columns == 0);
+	REQUIRE(adaptive.refined() == 0.f);
+	REQUIRE(grey_is(out, 0, 12, .25f));
+	REQUIRE(grey_is(out, 16, 32, 0.f));
+	REQUIRE_FALSE(grey_is(out, 12, 16, .25f));
+}
+
+TEST_CASE("dynamic resolution")
+{
+	// a frame costs full_ms at scale 1 and scales with the pixel count
+	auto settle = [](vml::render::resolution_controller &dyn, float full_ms, int frames)
+	{
+		bool bounded = true;
+		for (int i = 0; i < frames; ++i) {
+			dyn.update(full_ms * dyn.scale() * dyn.scale());
+			bounded = bounded && dyn.scale() >= .25f && dyn.scale() <= 1.f;
+		}
+		return bounded;
+	};
+
+	// 4 times over the budget: half the width and height, within the budget and staying there
+	vml::render::resolution_controller dyn(16.f);
+	REQUIRE(dyn.scale() == 1.f);
+	REQUIRE(settle(dyn, 64.f, 50));
+	REQUIRE(dyn.scale() == .5f);
+	REQUIRE(64.f * dyn.scale() * dyn.scale() <= dyn.target());
+	REQUIRE(settle(dyn, 64.f, 50));
+	REQUIRE(dyn.scale() == .5f);
+
+	// cheap again: back to full resolution, way over: never below the minimum
+	REQUIRE(settle(dyn, 1.f, 200));
+	REQUIRE(dyn.scale() == 1.f);
+	REQUIRE(settle(dyn, 1e4f, 50));
+	REQUIRE(dyn.scale() == .25f);
+
+	// no timing, no change
+	dyn.update(0.f);
+	dyn.update(-1.f);
+	REQUIRE(dyn.scale() == .25f);
+
+	// the view is the top left of the frame, even sized so quads stay whole
+	vml::render::image full(101, 57, vml::render::format::rgb8);
+	const auto fb = full.view();
+	for (const float full_ms : { 64.f, 30.f, 20.f, 1e4f }) {
+		vml::render::resolution_controller controller(16.f);
+		settle(controller, full_ms, 50);
+		const auto low = controller.view(fb);
+		REQUIRE(controller.scale() < 1.f);
+		REQUIRE(low.width % 2 == 0);
+		REQUIRE(low.height % 2 == 0);
+		REQUIRE(std::abs(low.width - fb.width * controller.scale()) <= 1.5f);
+		REQUIRE(std::abs(low.height - fb.height * controller.scale()) <= 1.5f);
+		REQUIRE(low.pixels == fb.pixels);
+		REQUIRE(low.pitch == fb.pitch);
+	}
+	vml::render::image tiny(3, 3, vml::render::format::rgb8);
+	REQUIRE(dyn.view(tiny.view()).width == 2);
+	vml::render::resolution_controller unscaled(16.f);
+	REQUIRE(unscaled.view(fb).width == 101);
+}
+
+TEST_CASE("upscale")
+{
+	vml::render::tile_scheduler scheduler(2, 4, 2, false);
+
+	// a constant image stays that constant, from a view with the pitch of the full frame as the renderer does
+	vml::render::image frame(16, 8, vml::render::format::rgba32f);
+	const auto low = vml::render::framebuffer { frame.view().pixels, 5, 3, frame.view().pitch, vml::render::format::rgba32f };
+	for (int y = 0; y < low.height; ++y) {
+		for (int x = 0; x < low.width; ++x) {
+			float *pixel = const_cast<float*>(pixel_at(low, x, y));
+			pixel[0] = pixel[1] = pixel[2] = .375f;
+			pixel[3] = 1.f;
+		}
+	}
+	vml::render::image big(16, 8, vml::render::format::rgba32f);
+	vml::render::upscale(low, big.view(), scheduler);
+	REQUIRE(grey_is(big.view(), 0, 16, .375f));
+
+	// 8-bit the same
+	vml::render::image small_rgb(3, 2, vml::render::format::rgb8), big_rgb(13, 7, vml::render::format::rgb8);
+	memset(small_rgb.view().pixels, 77, 3 * 2 * 3);
+	vml::render::upscale(small_rgb.view(), big_rgb.view(), scheduler);
+	const auto *bytes = static_cast<const uint8_t*>(big_rgb.view().pixels);
+	REQUIRE(std::all_of(bytes, bytes + 13 * 7 * 3, [](uint8_t b) { return b == 77; }));
+
+	// bilinear with the pixel centers lined up: 0 | 1 doubled is 0, .25, .75, 1
+	vml::render::image edge(2, 1, vml::render::format::rgba32f), wide(4, 1, vml::render::format::rgba32f);
+	float *texels = static_cast<float*>(edge.view().pixels);
+	std::fill(texels, texels + 4, 0.f);
+	std::fill(texels + 4, texels + 8, 1.f);
+	vml::render::upscale(edge.view(), wide.view(), scheduler);
+	REQUIRE(grey_is(wide.view(), 0, 1, 0.f));
+	REQUIRE(grey_is(wide.view(), 1, 2, .25f));
+	REQUIRE(grey_is(wide.view(), 2, 3, .75f));
+	REQUIRE(grey_is(wide.view(), 3, 4, 1.f));
+}
+
 TEST_CASE("spec::Par_5_4_2__Constructors")
 {
 	int _int = 1;
@@ -2,12 +2,12 @@
 
 #include "shader/sandbox.h"
 
- vec3 sandbox::iResolution = vec3(100, 100, 0);
-float sandbox::iTime = 0.f;
-float sandbox::iTimeDelta = 0.f;
-
 int main()
 {
+	sandbox::uniform_context uniforms = {};
+	uniforms.iResolution = vec3(100, 100, 0);
+	sandbox::current_uniforms = &uniforms;
+
 	sandbox::fragment_shader ps;
 	ps.main(ps.gl_FragColor, vec2(0));
 }
\ No newline at end of file
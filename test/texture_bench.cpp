@@ -0,0 +1,127 @@
+// What the texture layouts (see vml/sampler.h) cost per sample for different access patterns
+// usage: texture_bench [-s size] [-n samples] [-f nearest|bilinear]
+//   rows     - walks the texture along its rows, 1 texel per sample, the best case for linear
+//   rotated  - same walk turned 30 degrees, like a rotated quad or UV, the rows get crossed all the time
+//   minified - the rotated walk at 4 texels per sample, most of every cache line fetched goes unused
+//   random   - uniform random coordinates, nothing to win from any layout once the texture is past the caches
+// prints ns per sample, single threaded; Morton addresses use pdep in builds with BMI2 (-mbmi2, /arch:AVX2)
+
+#include "../vml/sampler.h"
+#include "../vml/rng.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using vec2 = vml::vector<float, 0, 1>;
+
+enum class access
+{
+	rows,
+	rotated,
+	minified,
+	random,
+};
+
+const char* name(access a)
+{
+	return a == access::rows ? "rows" : a == access::rotated ? "rotated" : a == access::minified ? "minified" : "random";
+}
+
+const char* name(vml::texture_layout layout)
+{
+	return layout == vml::texture_layout::linear ? "linear"
+		: layout == vml::texture_layout::tiled_4x4 ? "tiled 4x4"
+		: layout == vml::texture_layout::tiled_8x8 ? "tiled 8x8"
+		: "morton";
+}
+
+float ns_per_sample(const vml::sampler2D &s, int size, int samples, access pattern, float &checksum)
+{
+	// a screen of pixels walked row by row, every pixel one sample
+	const int width = 1024;
+	const float step = (pattern == access::minified ? 4.f : 1.f) / size;
+	const float angle = pattern == access::rows ? 0.f : .5235988f;
+	const float c = std::cos(angle) * step, sn = std::sin(angle) * step;
+	auto rng = vml::rng::seed(1u, 2u, 3u);
+
+	float sum = 0.f;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < samples; ++i) {
+		vec2 uv;
+		if (pattern == access::random) {
+			uv = vml::rng::next_vec2(rng);
+		} else {
+			const float x = static_cast<float>(i % width), y = static_cast<float>(i / width);
+			uv = vec2(x * c - y * sn, x * sn + y * c);
+		}
+		sum += textureLod(s, uv, 0.f).r;
+	}
+	const std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	checksum += sum;
+	return elapsed.count() / samples;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+	int size = 2048;
+	int samples = 1 << 22;
+	auto filtering = vml::filter::bilinear;
+
+	for (int i = 1; i < argc; ++i) {
+		const bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-s") == 0 && has_value) {
+			size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-n") == 0 && has_value) {
+			samples = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-f") == 0 && has_value) {
+			filtering = strcmp(argv[++i], "nearest") == 0 ? vml::filter::nearest : vml::filter::bilinear;
+		} else {
+			printf("usage: texture_bench [-s size] [-n samples] [-f nearest|bilinear]\n");
+			return 1;
+		}
+	}
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+	for (size_t i = 0; i < pixels.size(); ++i) {
+		pixels[i] = static_cast<uint8_t>(vml::rng::pcg(static_cast<uint32_t>(i)));
+	}
+
+#ifdef VML_SAMPLER_PDEP
+	const char *morton = "pdep";
+#else
+	const char *morton = "shifts";
+#endif
+	printf("%dx%d float rgba (%.0f MB), %d %s samples, morton addresses with %s\n", size, size,
+		size * size * 16 / (1024.f * 1024.f), samples, filtering == vml::filter::nearest ? "nearest" : "bilinear", morton);
+	const access patterns[] = { access::rows, access::rotated, access::minified, access::random };
+	printf("%-10s", "");
+	for (auto pattern : patterns) {
+		printf(" %10s", name(pattern));
+	}
+	printf("   (ns per sample)\n");
+
+	float checksum = 0.f;
+	for (auto layout : { vml::texture_layout::linear, vml::texture_layout::tiled_4x4, vml::texture_layout::tiled_8x8,
+		vml::texture_layout::morton }) {
+		const vml::texture_storage<2> tex({ size, size }, vml::texel_format::rgba8, pixels.data(), false, layout);
+		const auto s = tex.bind({ filtering, vml::wrap::repeat });
+
+		printf("%-10s", name(layout));
+		for (auto pattern : patterns) {
+			printf(" %10.2f", ns_per_sample(s, size, samples, pattern, checksum));
+		}
+		printf("\n");
+	}
+	printf("checksum: %g\n", checksum);
+
+	return 0;
+}
@@ -3,6 +3,7 @@
 #include <vml/matrix.h>
 #include <vml/vector.h>
 #include <vml/vector_functions.h>
+#include <vml/layout.h>
 
 namespace debug_vulkan
 {
@@ -110,6 +111,10 @@ namespace debug_vulkan
         // =============== INCLUDE GLSL CODE HERE =================
 #include "shaders/deferred_lighting.frag.hpp"
         // ===============
+
+        // Push constants use the std430 layout, the C++ side must match it byte for byte
+        static_assert(offsetof(push_constant_t, view_matrix) == vml::std430_block<vec4, mat4>::offset(1), "push constant layout mismatch");
+        static_assert(sizeof(push_constant_t) == vml::std430_block<vec4, mat4>::size(), "push constant layout mismatch");
     
     }
 
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vml {
+
+// compile time constant N / D that builtins can strength reduce
+// ex: pow(x, c<2>()) is x * x, x / c<3>() multiplies by the reciprocal, so does mod(x, c<2>()) (powers of 2 only)
+// anywhere else it just converts to the scalar it is used with, like the literal it stands for would:
+// an integer one (Integral, 2_c) stays an integer next to integers, any other (2.0_c, 0.5_c, c<2>())
+// turns integer operands into double, 3 * 0.5_c is 1.5 like 3 * 0.5
+template<intmax_t N, intmax_t D = 1, bool Integral = false>
+struct c
+{
+	static_assert(D != 0, "division by zero");
+
+	static constexpr intmax_t num = N;
+	static constexpr intmax_t den = D;
+	static constexpr bool integral = Integral;
+
+	template<typename T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+	constexpr operator T() const
+	{
+		return T(N) / T(D);
+	}
+
+	constexpr c<-N, D, Integral> operator -() const
+	{
+		return {};
+	}
+};
+
+namespace detail {
+
+constexpr intmax_t gcd(intmax_t a, intmax_t b)
+{
+	return b == 0 ? (a < 0 ? -a : a) : gcd(b, a % b);
+}
+
+template<intmax_t N, intmax_t D, bool Integral = false>
+using reduced_c = c<(D < 0 ? -N : N) / gcd(N, D), (D < 0 ? -D : D) / gcd(N, D), Integral>;
+
+template<intmax_t N>
+constexpr bool is_pow2 = N > 0 && (N & (N - 1)) == 0;
+
+template<intmax_t N>
+constexpr int log2_int = N <= 1 ? 0 : 1 + log2_int<N / 2>;
+
+template<typename T, class = void>
+struct scalar_of
+{};
+
+template<typename T>
+struct scalar_of<T, std::void_t<typename remove_cvref<decltype(decay(std::declval<T>()))>::type::scalar_type>>
+{
+	using type = typename remove_cvref<decltype(decay(std::declval<T>()))>::type::scalar_type;
+};
+
+template<typename T>
+struct scalar_of<T, typename std::enable_if<std::is_arithmetic<typename remove_cvref<T>::type>::value>::type>
+{
+	using type = typename remove_cvref<T>::type;
+};
+
+// what a constant converts to next to T: its scalar, or double for an integer one and a constant that is not
+template<typename T, bool Integral>
+using constant_scalar = typename std::conditional<std::is_integral<typename scalar_of<T>::type>::value && !Integral,
+	double, typename scalar_of<T>::type>::type;
+
+// decimal literal -> (mantissa, exponent) at compile time, ex: 2.5e-1 -> (25, -2)
+struct literal_parts
+{
+	intmax_t mantissa = 0;
+	int exponent = 0;
+	bool integral = true;	// no decimal point nor exponent
+};
+
+template<char... Cs>
+constexpr literal_parts parse_literal()
+{
+	constexpr char str[] = { Cs..., '\0' };
+	literal_parts out;
+	bool fraction = false;
+	size_t i = 0;
+
+	for (; str[i] && str[i] != 'e' && str[i] != 'E'; ++i) {
+		if (str[i] == '.') {
+			fraction = true;
+			out.integral = false;
+		} else if (str[i] != '\'') {
+			out.mantissa = out.mantissa * 10 + (str[i] - '0');
+			out.exponent -= fraction ? 1 : 0;
+		}
+	}
+
+	if (str[i]) {
+		out.integral = false;
+		int sign = 1, exp = 0;
+		if (str[++i] == '-') {
+			sign = -1;
+			++i;
+		} else if (str[i] == '+') {
+			++i;
+		}
+		for (; str[i]; ++i) {
+			exp = exp * 10 + (str[i] - '0');
+		}
+		out.exponent += sign * exp;
+	}
+
+	return out;
+}
+
+constexpr intmax_t power_of_10(int e)
+{
+	return e <= 0 ? 1 : 10 * power_of_10(e - 1);
+}
+
+template<char... Cs>
+struct literal_to_c
+{
+	static constexpr auto parts = parse_literal<Cs...>();
+	using type = reduced_c<
+		parts.mantissa * (parts.exponent > 0 ? power_of_10(parts.exponent) : 1),
+		parts.exponent < 0 ? power_of_10(-parts.exponent) : 1, parts.integral>;
+};
+
+} // namespace detail
+
+namespace literals {
+
+// 2.0_c is c<2>, 0.25_c is c<1, 4>, 2_c is c<2, 1, true>
+// hex, octal and binary literals are not supported
+template<char... Cs>
+constexpr typename detail::literal_to_c<Cs...>::type operator""_c()
+{
+	static_assert(sizeof...(Cs) < 2 || ((Cs != 'x' && Cs != 'X' && Cs != 'b' && Cs != 'B') && ...),
+		"only decimal literals are supported");
+	return {};
+}
+
+} // namespace literals
+
+// arithmetic just converts, except division which multiplies by the reciprocal
+// (or shifts for unsigned integers and integer powers of 2, and divides integers, promoted or not)
+#define DEF_OP_CONSTANT(op) \
+template<typename T, intmax_t N, intmax_t D, bool I> \
+constexpr auto operator op(T &&x, c<N, D, I> y) -> decltype(detail::decay(std::forward<T>(x)) op detail::constant_scalar<T, I>()) \
+{ \
+	return detail::decay(std::forward<T>(x)) op detail::constant_scalar<T, I>(y); \
+} \
+template<typename T, intmax_t N, intmax_t D, bool I> \
+constexpr auto operator op(c<N, D, I> x, T &&y) -> decltype(detail::constant_scalar<T, I>() op detail::decay(std::forward<T>(y))) \
+{ \
+	return detail::constant_scalar<T, I>(x) op detail::decay(std::forward<T>(y)); \
+}
+
+DEF_OP_CONSTANT(+)
+DEF_OP_CONSTANT(-)
+DEF_OP_CONSTANT(*)
+DEF_OP_CONSTANT(<)
+DEF_OP_CONSTANT(<=)
+DEF_OP_CONSTANT(>)
+DEF_OP_CONSTANT(>=)
+DEF_OP_CONSTANT(==)
+DEF_OP_CONSTANT(!=)
+
+#undef DEF_OP_CONSTANT
+
+template<typename T, intmax_t N, intmax_t D, bool I>
+constexpr auto operator /(T &&x, c<N, D, I>) -> decltype(detail::decay(std::forward<T>(x)) * detail::constant_scalar<T, I>())
+{
+	using scalar_type = detail::constant_scalar<T, I>;
+
+	if constexpr (std::is_integral<typename detail::remove_cvref<T>::type>::value
+		&& std::is_unsigned<scalar_type>::value && I && detail::is_pow2<N>) {
+		return detail::decay(std::forward<T>(x)) >> detail::log2_int<N>;
+	} else if constexpr (std::is_integral<typename detail::scalar_of<T>::type>::value) {
+		return detail::decay(std::forward<T>(x)) / scalar_type(c<N, D, I>());	// exact, 7 / 3.0 and not 7 * 0.333...
+	} else {
+		return detail::decay(std::forward<T>(x)) * (scalar_type(D) / scalar_type(N));
+	}
+}
+
+template<typename T, intmax_t N, intmax_t D, bool I>
+constexpr auto operator /(c<N, D, I> x, T &&y) -> decltype(detail::constant_scalar<T, I>() / detail::decay(std::forward<T>(y)))
+{
+	return detail::constant_scalar<T, I>(x) / detail::decay(std::forward<T>(y));
+}
+
+} // namespace vml
@@ -2,6 +2,9 @@
 
 #include <cmath>
 
+#include "lut.h"
+#include "quad.h"
+
 namespace vml { namespace detail
 {
 
@@ -39,12 +42,20 @@ struct builtin_func_lib
 
 	LIB vector_type FUNC(sin)(vector_arg_type t)
 	{
+#ifdef VML_LUT_SIN
+		return vector_type(lut::sin(t.data[Ns])...);
+#else
 		return vector_type(std::sin(t.data[Ns])...);
+#endif
 	}
 
 	LIB vector_type FUNC(cos)(vector_arg_type t)
 	{
+#ifdef VML_LUT_COS
+		return vector_type(lut::cos(t.data[Ns])...);
+#else
 		return vector_type(std::cos(t.data[Ns])...);
+#endif
 	}
 
 	LIB vector_type FUNC(tan)(vector_arg_type t)
@@ -82,6 +93,26 @@ struct builtin_func_lib
 		return vector_type(std::pow(x.data[Ns], y.data[Ns])...);
 	}
 
+	// x^N for a compile time N, unrolled into multiplies by squaring
+	template<int N>
+	LIB vector_type FUNC(pown)(vector_arg_type x)
+	{
+		if constexpr (N < 0) {
+			return vector_type(one) / FUNC(pown)<-N>(x);
+		} else if constexpr (N == 0) {
+			return vector_type(one);
+		} else if constexpr (N == 1) {
+			return x;
+		} else {
+			const vector_type half = FUNC(pown)<N / 2>(x);
+			if constexpr (N % 2 == 0) {
+				return half * half;
+			} else {
+				return half * half * x;
+			}
+		}
+	}
+
 	LIB vector_type FUNC(exp)(vector_arg_type t)
 	{
 		return vector_type(std::exp(t.data[Ns])...);
@@ -94,12 +125,20 @@ struct builtin_func_lib
 
 	LIB vector_type FUNC(exp2)(vector_arg_type t)
 	{
+#ifdef VML_LUT_EXP2
+		return vector_type(lut::exp2(t.data[Ns])...);
+#else
 		return vector_type(std::exp2(t.data[Ns])...);
+#endif
 	}
 
 	LIB vector_type FUNC(log2)(vector_arg_type t)
 	{
+#ifdef VML_LUT_LOG2
+		return vector_type(lut::log2(t.data[Ns])...);
+#else
 		return vector_type(std::log2(t.data[Ns])...);
+#endif
 	}
 
 	LIB vector_type FUNC(sqrt)(vector_arg_type t)
@@ -342,15 +381,27 @@ struct builtin_func_lib
 
 //
 // 8.13.1 Derivative Functions
-// NOTE: can only fake these
+// NOTE: real finite differences only when shading quads (see quad.h), faked otherwise
 	LIB vector_type FUNC(dFdx)(vector_arg_type p)
 	{
+#ifdef VML_QUAD_SHADING
+		vector_type out;
+		quad::derivative(p.data, out.data, 1);
+		return out;
+#else
 		return p * scalar_type(.01);
+#endif
 	}
 
 	LIB vector_type FUNC(dFdy)(vector_arg_type p)
 	{
+#ifdef VML_QUAD_SHADING
+		vector_type out;
+		quad::derivative(p.data, out.data, 2);
+		return out;
+#else
 		return p * scalar_type(.01);
+#endif
 	}
 
 	LIB vector_type FUNC(fwidth)(vector_arg_type p)
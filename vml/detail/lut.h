@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Lookup table backend for builtin_func_lib
+// opt-in per function, config #define's
+// VML_LUT_SIN (and cos)
+// VML_LUT_COS
+// VML_LUT_EXP2
+// VML_LUT_LOG2
+//
+// The tables are generated at compile time and interpolated linearly,
+// all of them together take ~1.5KB so they stay in L1.
+// Max abs error: sin/cos 7.5e-5, exp2 1.5e-5 relative, log2 4.4e-5 - all well under
+// half a step of 8-bit output (2e-3), only float is affected, double keeps using std::
+// See test/lut_report.cpp for the difference it makes on the reference shaders.
+
+namespace vml { namespace detail { namespace lut {
+
+constexpr double pi = 3.14159265358979323846;
+constexpr double ln2 = 0.69314718055994530942;
+
+// constexpr versions of the std:: functions, only valid on the small ranges the tables need
+constexpr double sin_taylor(double x) // x in [-pi, pi]
+{
+	double term = x, sum = x;
+	for (int i = 1; i < 16; ++i) {
+		term *= -x * x / ((2 * i) * (2 * i + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double exp_taylor(double x) // x in [0, ln2]
+{
+	double term = 1, sum = 1;
+	for (int i = 1; i < 16; ++i) {
+		term *= x / i;
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double log_atanh(double x) // x in [1, 2]: ln(x) = 2 atanh((x - 1) / (x + 1))
+{
+	const double y = (x - 1) / (x + 1);
+	double term = y, sum = y;
+	for (int i = 1; i < 16; ++i) {
+		term *= y * y;
+		sum += term / (2 * i + 1);
+	}
+	return 2 * sum;
+}
+
+// N intervals plus one more sample so interpolation never wraps
+template<size_t N>
+struct table
+{
+	static constexpr size_t size = N;
+	float data[N + 1];
+};
+
+template<size_t N>
+constexpr table<N> make_sin_table() // one period over [0, 2pi]
+{
+	table<N> out = {};
+	for (size_t i = 0; i <= N; ++i) {
+		const double x = 2 * pi * i / N;
+		out.data[i] = static_cast<float>(sin_taylor(x <= pi ? x : x - 2 * pi));
+	}
+	return out;
+}
+
+template<size_t N>
+constexpr table<N> make_exp2_table() // 2^x over [0, 1]
+{
+	table<N> out = {};
+	for (size_t i = 0; i <= N; ++i) {
+		out.data[i] = static_cast<float>(exp_taylor(ln2 * i / N));
+	}
+	return out;
+}
+
+template<size_t N>
+constexpr table<N> make_log2_table() // log2(x) over [1, 2]
+{
+	table<N> out = {};
+	for (size_t i = 0; i <= N; ++i) {
+		out.data[i] = static_cast<float>(log_atanh(1 + double(i) / N) / ln2);
+	}
+	return out;
+}
+
+inline constexpr auto sin_table = make_sin_table<256>();
+inline constexpr auto exp2_table = make_exp2_table<64>();
+inline constexpr auto log2_table = make_log2_table<64>();
+
+template<size_t N>
+inline float lerp(const table<N> &t, int i, float f)
+{
+	return t.data[i] + (t.data[i + 1] - t.data[i]) * f;
+}
+
+// floor that doesn't call into the CRT when SSE4 isn't around
+inline int64_t floor_int(float x)
+{
+	const auto i = static_cast<int64_t>(x);
+	return i - (x < static_cast<float>(i));
+}
+
+inline float sin(float x)
+{
+	constexpr auto N = decltype(sin_table)::size;
+	const float t = x * static_cast<float>(N / (2 * pi));
+	const auto i = floor_int(t);
+	return lerp(sin_table, static_cast<int>(i & (N - 1)), t - static_cast<float>(i));
+}
+
+inline float cos(float x)
+{
+	return sin(x + static_cast<float>(pi / 2));
+}
+
+inline float exp2(float x)
+{
+	constexpr auto N = decltype(exp2_table)::size;
+	if (!(x > -126.f)) { // NaN too
+		return x != x ? x : 0.f;
+	}
+	if (x >= 128.f) {
+		return HUGE_VALF;
+	}
+
+	const auto i = floor_int(x);
+	const float t = (x - static_cast<float>(i)) * N;
+	// t rounds up to N for x just below an integer, that is the last interval at its end
+	const auto j = t < static_cast<float>(N) ? static_cast<int>(t) : static_cast<int>(N) - 1;
+	float out = lerp(exp2_table, j, t - static_cast<float>(j));
+
+	// scale by 2^i straight in the exponent bits, wrapping around unsigned for i < 0
+	uint32_t bits;
+	memcpy(&bits, &out, sizeof(bits));
+	bits += static_cast<uint32_t>(i) << 23;
+	memcpy(&out, &bits, sizeof(bits));
+	return out;
+}
+
+inline float log2(float x)
+{
+	constexpr auto N = decltype(log2_table)::size;
+	int32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+
+	const int32_t exponent = (bits >> 23) & 0xff;
+	if (bits <= 0 || exponent == 0 || exponent == 0xff) { // negative, zero, denormal, inf or NaN
+		return std::log2(x);
+	}
+
+	const int32_t mantissa = bits & 0x7fffff;
+	const float t = static_cast<float>(mantissa) * (static_cast<float>(N) / (1 << 23));
+	const auto j = static_cast<int>(t);
+	return static_cast<float>(exponent - 127) + lerp(log2_table, j, t - static_cast<float>(j));
+}
+
+// everything else stays on std::
+template<typename T> inline auto sin(T x) { return std::sin(x); }
+template<typename T> inline auto cos(T x) { return std::cos(x); }
+template<typename T> inline auto exp2(T x) { return std::exp2(x); }
+template<typename T> inline auto log2(T x) { return std::log2(x); }
+
+} } } // namespace vml::detail::lut
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstring>
+
+// 2x2 quad shading for real dFdx/dFdy/fwidth
+// config #define's
+// VML_QUAD_SHADING - derivatives come from the quad context below, otherwise they are faked
+//
+// GPUs run the 4 pixels of a quad in lockstep and take finite differences between the lanes.
+// On the CPU the lanes run one after the other, so a quad is shaded in passes instead:
+// every pass records the argument of the n-th derivative call of every lane
+// and answers it with the difference of what the neighbouring lanes recorded on the pass before.
+// A shader without derivatives is done after the first pass, the usual case takes 2 passes
+// and derivatives of values that themselves depend on derivatives take one more pass per level.
+// Like on the GPU the results are only defined if the 4 lanes take the same path to the call.
+
+namespace vml { namespace detail { namespace quad {
+
+constexpr int max_calls = 64;	// per invocation, later calls get 0
+constexpr int max_passes = 4;
+
+struct context
+{
+	// lane = x | y << 1, with y going up like gl_FragCoord
+	// dFdx is lane 1 - lane 0 (3 - 2), dFdy is lane 2 - lane 0 (3 - 1)
+	int lane = 0;
+	int pass = 0;
+	int calls = 0;
+	float scale = 1;	// lanes further apart than a pixel: 1 / distance
+
+	int counts[2][4] = {};					// [pass & 1][lane]
+	float args[2][4][max_calls][4] = {};	// [pass & 1][lane][call][component]
+};
+
+// the quad being shaded by this thread, nullptr outside of quad::shade()
+inline thread_local context *current = nullptr;
+
+// axis: 1 for x, 2 for y
+template<size_t N, typename T>
+inline void derivative(const T (&p)[N], T (&out)[N], int axis)
+{
+	static_assert(N <= 4, "up to 4 components");
+
+	context *ctx = current;
+	for (size_t i = 0; i < N; ++i) {
+		out[i] = T(0);
+	}
+	if (!ctx) {
+		return;
+	}
+
+	const int call = ctx->calls++;
+	if (call >= max_calls) {
+		return;
+	}
+
+	const int now = ctx->pass & 1;
+	for (size_t i = 0; i < N; ++i) {
+		ctx->args[now][ctx->lane][call][i] = static_cast<float>(p[i]);
+	}
+
+	const int before = now ^ 1;
+	const int lo = ctx->lane & ~axis;
+	const int hi = ctx->lane | axis;
+	if (ctx->pass == 0 || call >= ctx->counts[before][lo] || call >= ctx->counts[before][hi]) {
+		return;
+	}
+	for (size_t i = 0; i < N; ++i) {
+		out[i] = static_cast<T>((ctx->args[before][hi][call][i] - ctx->args[before][lo][call][i]) * ctx->scale);
+	}
+}
+
+// calls shade_lane(lane) for the 4 lanes of a quad, as many times as it takes the derivatives to settle
+// the results of the last call of every lane are the ones to keep
+template<class Func>
+inline void shade(context &ctx, Func &&shade_lane)
+{
+	context *outer = current;
+	current = &ctx;
+
+	for (ctx.pass = 0; ctx.pass < max_passes; ++ctx.pass) {
+		const int now = ctx.pass & 1;
+		for (ctx.lane = 0; ctx.lane < 4; ++ctx.lane) {
+			ctx.calls = 0;
+			shade_lane(ctx.lane);
+			ctx.counts[now][ctx.lane] = ctx.calls < max_calls ? ctx.calls : max_calls;
+		}
+
+		bool settled = true;
+		for (int lane = 0; lane < 4 && settled; ++lane) {
+			const int count = ctx.counts[now][lane];
+			settled = count == 0 || (ctx.pass > 0 && count == ctx.counts[now ^ 1][lane]
+				&& memcmp(ctx.args[now][lane], ctx.args[now ^ 1][lane], sizeof(ctx.args[0][0][0]) * count) == 0);
+		}
+		if (settled) {
+			break;
+		}
+	}
+
+	current = outer;
+}
+
+} } } // namespace vml::detail::quad
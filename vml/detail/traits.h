@@ -87,6 +87,10 @@ template<> struct promote_to_vec_impl<long int> : scalar_to_vector<long int> {};
 template<> struct promote_to_vec_impl<float> : scalar_to_vector<float> {};
 template<> struct promote_to_vec_impl<double> : scalar_to_vector<double> {};
 
+// specialization: compile time constants act as float literals
+template<intmax_t N, intmax_t D, bool I>
+struct promote_to_vec_impl<::vml::c<N, D, I>> : scalar_to_vector<float> {};
+
 constexpr int vec_traits_test()
 {
 	using  vec1 = ::vml::vector<float, 0>;
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+
+#include "vector.h"
+#include "matrix.h"
+
+// GLSL std140 / std430 memory layouts
+// https://www.khronos.org/registry/OpenGL/specs/gl/glspec45.core.pdf#page=159 (7.6.2.2 Standard Uniform Block Layout)
+//
+// usage:
+//   struct push_k_t
+//   {
+//       vml::std430<vec4> light_direction;
+//       vml::std430<mat4> view_matrix;
+//   };
+//   static_assert(vml::std430_block<vec4, mat4>::offset(1) == offsetof(push_k_t, view_matrix), "layout mismatch");
+//
+// NOTE: C++ objects can't have a size smaller than their alignment so std140<vec3> occupies
+// all 16 bytes of its slot; GLSL would pack a following scalar into the last 4 bytes.
+// The std140_block/std430_block offsets follow GLSL exactly so the static_assert above catches that.
+
+namespace vml {
+
+namespace detail {
+
+constexpr size_t align_up(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+struct std140_rules
+{
+	static constexpr bool round_to_vec4 = true; // arrays and structs are rounded to the base alignment of a vec4
+};
+
+struct std430_rules
+{
+	static constexpr bool round_to_vec4 = false;
+};
+
+// `alignment` is the base alignment and `size` the bytes actually covered (vec3 covers 12)
+template<typename T, typename rules, class = void>
+struct layout_traits // structures (rule 9): alignment of the biggest member
+{
+	static constexpr size_t alignment = rules::round_to_vec4 ? align_up(alignof(T), 16) : alignof(T);
+	static constexpr size_t size = sizeof(T);
+};
+
+template<typename T, typename rules>
+struct layout_traits<T, rules, typename std::enable_if<std::is_arithmetic<T>::value>::type> // rule 1
+{
+	static_assert(sizeof(T) == 4 || sizeof(T) == 8, "only 32 and 64 bit scalars exist in GLSL");
+
+	static constexpr size_t alignment = sizeof(T);
+	static constexpr size_t size = sizeof(T);
+};
+
+template<typename T, size_t... Ns, typename rules>
+struct layout_traits<vector<T, Ns...>, rules> // rules 2 and 3
+{
+	static constexpr size_t num_components = sizeof...(Ns);
+	static_assert(num_components <= 4, "GLSL vectors have at most 4 components");
+
+	static constexpr size_t alignment = layout_traits<T, rules>::size * (num_components == 3 ? 4 : num_components);
+	static constexpr size_t size = layout_traits<T, rules>::size * num_components;
+};
+
+template<typename T, size_t N, typename rules>
+struct layout_traits<T[N], rules> // rule 4 (and 10 for arrays of structures)
+{
+	static constexpr size_t alignment = rules::round_to_vec4 ?
+		align_up(layout_traits<T, rules>::alignment, 16) : layout_traits<T, rules>::alignment;
+	static constexpr size_t stride = align_up(layout_traits<T, rules>::size, alignment);
+	static constexpr size_t size = stride * N;
+};
+
+template<
+	typename T,
+	template<typename, size_t...> class vector_type,
+	size_t... Columns,
+	size_t... Rows,
+	typename rules
+>
+struct layout_traits<matrix<T, vector_type, indices_pack<Columns...>, indices_pack<Rows...>>, rules>
+	: layout_traits<vector_type<T, Columns...>[sizeof...(Rows)], rules> // rule 5: array of column vectors
+{};
+
+// storage for one value padded up to its GLSL base alignment
+template<typename T, size_t alignment>
+struct alignas(alignment) padded
+{
+	T value;
+};
+
+template<typename T, typename rules>
+struct layout_wrapper
+{
+	using traits = layout_traits<T, rules>;
+	using value_type = T;
+
+	layout_wrapper() = default;
+
+	layout_wrapper(const T &v)
+	{
+		storage.value = v;
+	}
+
+	layout_wrapper& operator=(const T &v)
+	{
+		storage.value = v;
+		return *this;
+	}
+
+	operator T&()
+	{
+		return storage.value;
+	}
+
+	operator const T&() const
+	{
+		return storage.value;
+	}
+
+	T* operator->()
+	{
+		return &storage.value;
+	}
+
+	const T* operator->() const
+	{
+		return &storage.value;
+	}
+
+private:
+	padded<T, traits::alignment> storage;
+};
+
+// arrays and matrices need their elements re-strided
+template<typename E, size_t N, typename rules>
+struct layout_array_wrapper
+{
+	using traits = layout_traits<E[N], rules>;
+
+	E& operator[](size_t i)
+	{
+		return elements[i].value;
+	}
+
+	const E& operator[](size_t i) const
+	{
+		return elements[i].value;
+	}
+
+private:
+	padded<E, traits::alignment> elements[N];
+};
+
+template<typename T, size_t N, typename rules>
+struct layout_wrapper<T[N], rules> : layout_array_wrapper<T, N, rules>
+{
+	using traits = layout_traits<T[N], rules>;
+};
+
+// these convert by value since the memory image differs from the C++ one
+template<
+	typename T,
+	template<typename, size_t...> class vector_type,
+	size_t... Columns,
+	size_t... Rows,
+	typename rules
+>
+struct layout_wrapper<matrix<T, vector_type, indices_pack<Columns...>, indices_pack<Rows...>>, rules>
+	: layout_array_wrapper<vector_type<T, Columns...>, sizeof...(Rows), rules>
+{
+	using value_type = matrix<T, vector_type, indices_pack<Columns...>, indices_pack<Rows...>>;
+	using traits = layout_traits<value_type, rules>;
+
+	layout_wrapper() = default;
+
+	layout_wrapper(const value_type &m)
+	{
+		*this = m;
+	}
+
+	layout_wrapper& operator=(const value_type &m)
+	{
+		(((*this)[Rows] = m[Rows]), ...);
+		return *this;
+	}
+
+	operator value_type() const
+	{
+		value_type out;
+		((out[Rows] = (*this)[Rows]), ...);
+		return out;
+	}
+};
+
+// offsets of the members of a GLSL block, in declaration order
+template<typename rules, typename... Ts>
+struct block_layout
+{
+	static constexpr size_t count = sizeof...(Ts);
+
+	static constexpr size_t offset(size_t index)
+	{
+		constexpr size_t alignments[] = { layout_traits<Ts, rules>::alignment... };
+		constexpr size_t sizes[] = { layout_traits<Ts, rules>::size... };
+
+		size_t out = 0;
+		for (size_t i = 0; i <= index; ++i) {
+			out = align_up(out, alignments[i]);
+			if (i != index) {
+				out += sizes[i];
+			}
+		}
+		return out;
+	}
+
+	static constexpr size_t alignment()
+	{
+		size_t out = rules::round_to_vec4 ? 16 : 1;
+		((out = out < layout_traits<Ts, rules>::alignment ? layout_traits<Ts, rules>::alignment : out), ...);
+		return out;
+	}
+
+	static constexpr size_t size() // end of the last member, rounded up to the block alignment
+	{
+		constexpr size_t sizes[] = { layout_traits<Ts, rules>::size... };
+		return align_up(offset(count - 1) + sizes[count - 1], alignment());
+	}
+};
+
+} // namespace detail
+
+template<typename T>
+using std140 = detail::layout_wrapper<T, detail::std140_rules>;
+
+template<typename T>
+using std430 = detail::layout_wrapper<T, detail::std430_rules>;
+
+template<typename... Ts>
+using std140_block = detail::block_layout<detail::std140_rules, Ts...>;
+
+template<typename... Ts>
+using std430_block = detail::block_layout<detail::std430_rules, Ts...>;
+
+} // namespace vml
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "vector.h"
+#include "rng.h"
+
+// Tileable 3D noise for baking volumes (see sampler3D in sampler.h): gradient (Perlin) and cellular (Worley)
+// both are on a lattice of unit cells that repeats every period cells on every axis, so a volume of
+// period cells across wraps around without a seam; the lattice is hashed with rng::pcg3d, no permutation tables
+// fbm sums octaves at twice the frequency and half the amplitude, the period doubling along so it still tiles
+//
+// usage:
+//   float n = vml::noise::perlin_fbm(uvw * 8.f, 8, 5); // uvw in [0, 1) repeats, 8 cells across, 5 octaves
+
+namespace vml { namespace noise {
+
+using uint = rng::uint;
+
+namespace detail {
+
+inline int wrapped(int i, int period)
+{
+	i %= period;
+	return i < 0 ? i + period : i;
+}
+
+inline void hash(int x, int y, int z, int period, uint seed, uint &a, uint &b, uint &c)
+{
+	a = static_cast<uint>(wrapped(x, period));
+	b = static_cast<uint>(wrapped(y, period));
+	c = static_cast<uint>(wrapped(z, period)) ^ rng::pcg(seed);
+	rng::pcg3d(a, b, c);
+}
+
+// the 12 edges of the cube, Perlin's "Improving Noise" (2002)
+inline float gradient_dot(uint h, float x, float y, float z)
+{
+	switch (h % 12u) {
+	case 0: return x + y;
+	case 1: return -x + y;
+	case 2: return x - y;
+	case 3: return -x - y;
+	case 4: return x + z;
+	case 5: return -x + z;
+	case 6: return x - z;
+	case 7: return -x - z;
+	case 8: return y + z;
+	case 9: return -y + z;
+	case 10: return y - z;
+	default: return -y - z;
+	}
+}
+
+inline float fade(float t)
+{
+	return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+}
+
+inline float lerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
+} // namespace detail
+
+// gradient noise in about [-1, 1], 0 on the lattice points
+inline float perlin(const vector<float, 0, 1, 2> &p, int period, uint seed = 0)
+{
+	const float fx = std::floor(p.data[0]), fy = std::floor(p.data[1]), fz = std::floor(p.data[2]);
+	const int x = static_cast<int>(fx), y = static_cast<int>(fy), z = static_cast<int>(fz);
+	const float dx = p.data[0] - fx, dy = p.data[1] - fy, dz = p.data[2] - fz;
+
+	float corners[8];
+	for (int i = 0; i < 8; ++i) {
+		const int cx = i & 1, cy = (i >> 1) & 1, cz = i >> 2;
+		uint a, b, c;
+		detail::hash(x + cx, y + cy, z + cz, period, seed, a, b, c);
+		corners[i] = detail::gradient_dot(a, dx - cx, dy - cy, dz - cz);
+	}
+
+	const float u = detail::fade(dx), v = detail::fade(dy), w = detail::fade(dz);
+	const float bottom = detail::lerp(detail::lerp(corners[0], corners[1], u), detail::lerp(corners[2], corners[3], u), v);
+	const float top = detail::lerp(detail::lerp(corners[4], corners[5], u), detail::lerp(corners[6], corners[7], u), v);
+	return detail::lerp(bottom, top, w);
+}
+
+// distance to the closest of one random point per cell, in [0, 1] (clamped, it could reach sqrt(3) in theory)
+inline float worley(const vector<float, 0, 1, 2> &p, int period, uint seed = 0)
+{
+	const float fx = std::floor(p.data[0]), fy = std::floor(p.data[1]), fz = std::floor(p.data[2]);
+	const int x = static_cast<int>(fx), y = static_cast<int>(fy), z = static_cast<int>(fz);
+	const float dx = p.data[0] - fx, dy = p.data[1] - fy, dz = p.data[2] - fz;
+
+	float closest = 1.f;
+	for (int k = -1; k <= 1; ++k) {
+		for (int j = -1; j <= 1; ++j) {
+			for (int i = -1; i <= 1; ++i) {
+				uint a, b, c;
+				detail::hash(x + i, y + j, z + k, period, seed, a, b, c);
+				const float ox = i + rng::to_float(a) - dx;
+				const float oy = j + rng::to_float(b) - dy;
+				const float oz = k + rng::to_float(c) - dz;
+				closest = std::fmin(closest, ox * ox + oy * oy + oz * oz);
+			}
+		}
+	}
+	return std::sqrt(closest);
+}
+
+// perlin() octaves remapped to [0, 1]
+inline float perlin_fbm(const vector<float, 0, 1, 2> &p, int period, int octaves, uint seed = 0)
+{
+	float sum = 0.f, amplitude = 1.f, total = 0.f, frequency = 1.f;
+	for (int octave = 0; octave < octaves; ++octave) {
+		sum += amplitude * perlin(p * frequency, period << octave, seed + octave);
+		total += amplitude;
+		amplitude *= .5f;
+		frequency *= 2.f;
+	}
+	return total > 0.f ? .5f + .5f * sum / total : .5f;
+}
+
+// 1 - worley() octaves, in [0, 1]: billowy, 1 at the points
+inline float worley_fbm(const vector<float, 0, 1, 2> &p, int period, int octaves, uint seed = 0)
+{
+	float sum = 0.f, amplitude = 1.f, total = 0.f, frequency = 1.f;
+	for (int octave = 0; octave < octaves; ++octave) {
+		sum += amplitude * (1.f - worley(p * frequency, period << octave, seed + octave));
+		total += amplitude;
+		amplitude *= .5f;
+		frequency *= 2.f;
+	}
+	return total > 0.f ? sum / total : 0.f;
+}
+
+} } // namespace vml::noise
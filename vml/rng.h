@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "vector.h"
+
+// Counter based random numbers for stochastic shaders (path tracing, AO, ...)
+// every draw is a hash of (pixel, frame, sample, counter) so there is no state to carry between pixels
+// and the components of a vec2/vec3 are independent hashes the compiler can run side by side
+//
+// usage:
+//   auto rng = vml::rng::seed(fragCoord, iFrame, sample);
+//   vec3 dir = vml::rng::hemisphere_cosine(vml::rng::next_vec2(rng), normal);
+//
+// hash: "Hash Functions for GPU Rendering", Jarzynski & Olano, JCGT 2020 (pcg and pcg3d)
+
+namespace vml { namespace rng {
+
+using uint = uint32_t;
+
+// single round of PCG, permuted output
+constexpr uint pcg(uint v)
+{
+	const uint state = v * 747796405u + 2891336453u;
+	const uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// 3 inputs to 3 outputs, every output depends on all the inputs
+constexpr void pcg3d(uint &x, uint &y, uint &z)
+{
+	x = x * 1664525u + 1013904223u;
+	y = y * 1664525u + 1013904223u;
+	z = z * 1664525u + 1013904223u;
+	x += y * z; y += z * x; z += x * y;
+	x ^= x >> 16u; y ^= y >> 16u; z ^= z >> 16u;
+	x += y * z; y += z * x; z += x * y;
+}
+
+// [0, 1) with the 24 bits a float can hold
+constexpr float to_float(uint v)
+{
+	return static_cast<float>(v >> 8u) * (1.f / 16777216.f);
+}
+
+struct state
+{
+	uint key;
+	uint counter;
+};
+
+inline state seed(uint x, uint y, uint frame, uint sample = 0)
+{
+	uint z = frame ^ pcg(sample);
+	pcg3d(x, y, z);
+	return { x ^ y ^ z, 0 };
+}
+
+template<typename V, class = decltype(std::declval<const V &>().data[1])>
+inline state seed(const V &frag_coord, int frame, int sample = 0)
+{
+	return seed(static_cast<uint>(frag_coord.data[0]), static_cast<uint>(frag_coord.data[1]),
+		static_cast<uint>(frame), static_cast<uint>(sample));
+}
+
+namespace detail {
+
+template<size_t... Ns>
+inline vector<float, Ns...> next(state &s)
+{
+	const uint base = s.counter;
+	s.counter += sizeof...(Ns);
+	return vector<float, Ns...>(to_float(pcg(s.key + base + Ns))...);
+}
+
+} // namespace detail
+
+//
+// uniform samples in [0, 1)
+//
+inline float next_float(state &s)
+{
+	return to_float(pcg(s.key + s.counter++));
+}
+
+inline vector<float, 0, 1> next_vec2(state &s)
+{
+	return detail::next<0, 1>(s);
+}
+
+inline vector<float, 0, 1, 2> next_vec3(state &s)
+{
+	return detail::next<0, 1, 2>(s);
+}
+
+//
+// warps from the unit square (u = next_vec2)
+//
+constexpr float two_pi = 6.28318530717958647692f;
+
+// uniform on the unit disk
+inline vector<float, 0, 1> disk(const vector<float, 0, 1> &u)
+{
+	const float r = std::sqrt(u.data[0]);
+	const float phi = two_pi * u.data[1];
+	return vector<float, 0, 1>(r * std::cos(phi), r * std::sin(phi));
+}
+
+// uniform on the unit sphere
+inline vector<float, 0, 1, 2> sphere(const vector<float, 0, 1> &u)
+{
+	const float z = 1.f - 2.f * u.data[0];
+	const float r = std::sqrt(std::fmax(0.f, 1.f - z * z));
+	const float phi = two_pi * u.data[1];
+	return vector<float, 0, 1, 2>(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// uniform on the hemisphere around +z
+inline vector<float, 0, 1, 2> hemisphere(const vector<float, 0, 1> &u)
+{
+	const float z = u.data[0];
+	const float r = std::sqrt(std::fmax(0.f, 1.f - z * z));
+	const float phi = two_pi * u.data[1];
+	return vector<float, 0, 1, 2>(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// cosine weighted on the hemisphere around +z (pdf = cos / pi)
+inline vector<float, 0, 1, 2> hemisphere_cosine(const vector<float, 0, 1> &u)
+{
+	const auto d = disk(u);
+	const float z = std::sqrt(std::fmax(0.f, 1.f - d.data[0] * d.data[0] - d.data[1] * d.data[1]));
+	return vector<float, 0, 1, 2>(d.data[0], d.data[1], z);
+}
+
+// rotate a +z sample around the (unit) normal n
+// "Building an Orthonormal Basis, Revisited", Duff et al., JCGT 2017
+inline vector<float, 0, 1, 2> to_normal(const vector<float, 0, 1, 2> &v, const vector<float, 0, 1, 2> &n)
+{
+	const float sign = std::copysign(1.f, n.data[2]);
+	const float a = -1.f / (sign + n.data[2]);
+	const float b = n.data[0] * n.data[1] * a;
+	const vector<float, 0, 1, 2> t(1.f + sign * n.data[0] * n.data[0] * a, sign * b, -sign * n.data[0]);
+	const vector<float, 0, 1, 2> bt(b, sign + n.data[1] * n.data[1] * a, -n.data[1]);
+	return t * v.data[0] + bt * v.data[1] + n * v.data[2];
+}
+
+inline vector<float, 0, 1, 2> hemisphere(const vector<float, 0, 1> &u, const vector<float, 0, 1, 2> &n)
+{
+	return to_normal(hemisphere(u), n);
+}
+
+inline vector<float, 0, 1, 2> hemisphere_cosine(const vector<float, 0, 1> &u, const vector<float, 0, 1, 2> &n)
+{
+	return to_normal(hemisphere_cosine(u), n);
+}
+
+} } // namespace vml::rng
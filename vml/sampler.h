@@ -0,0 +1,816 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vector.h"
+
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define VML_SAMPLER_PDEP
+#endif
+
+// CPU texture sampling: GLSL's sampler2D, sampler3D and samplerCube with texture(), textureLod(), texelFetch() and textureSize()
+// nothing in here is tied to a graphics API, the texels are plain memory
+//
+// texels are always float rgba: any other format is converted once when a texture_storage is made,
+// so the filters never look at formats and every texel is 4 floats the compiler does in one vector op
+// a sampler is a small view (levels, filter, wrap) of a texture_storage or of any float rgba memory,
+// cheap to copy into the uniforms of a shader; it doesn't own the texels, they have to outlive it
+//
+// filter::nearest and filter::bilinear read the closest mip level, filter::trilinear blends the two closest
+// (3D textures take 8 texels per level instead of 4)
+// texture() takes the level of detail from the derivatives of the coordinates when shading quads (see detail/quad.h),
+// like on the GPU that only works from where the 4 lanes take the same path; textures without mips skip that
+//
+// a cubemap is a 2D texture of six layers, one per face, every level holds all of them as its slices;
+// its filters are seamless: the texels past the edge of a face come from the face next to it, so there is no seam
+// in the sky at any level (wrap is ignored)
+//
+// the memory layout is picked when a texture_storage is made (see texture_layout), the filters are compiled
+// once per layout and the layout is looked at once per sample, not per texel
+//
+// usage:
+//   vml::texture_storage<2> tex({ 256, 256 }, vml::texel_format::rgba8, pixels);	// row 0 is the bottom
+//   vml::sampler2D s = tex.bind({ vml::filter::trilinear, vml::wrap::repeat });
+//   vec4 color = texture(s, uv);
+//   vml::cubemap_storage sky(128, vml::texel_format::rgb32f, faces);	// +x, -x, +y, -y, +z, -z
+//   vec4 color = texture(sky.bind({ vml::filter::trilinear }), direction);
+
+namespace vml {
+
+enum class filter
+{
+	nearest,
+	bilinear,
+	trilinear,
+};
+
+enum class wrap
+{
+	repeat,	// GL_REPEAT
+	clamp,	// GL_CLAMP_TO_EDGE
+	mirror,	// GL_MIRRORED_REPEAT
+};
+
+struct sampler_state
+{
+	filter filtering = filter::bilinear;
+	wrap wrapping = wrap::repeat;	// on all the axes
+};
+
+// what a texture_storage is made from; missing green and blue read as 0, missing alpha as 1 like in GL
+enum class texel_format
+{
+	r8,
+	rgb8,
+	rgba8,
+	r32f,
+	rgb32f,
+	rgba32f,
+};
+
+// row-major is what any image is, but it thrashes the cache when the coordinates walk across rows
+// (rotated or diagonal UVs, minified lookups): the other layouts keep 2D neighbourhoods in the same cache lines
+// 3D textures lay out every slice like that, one after the other
+enum class texture_layout
+{
+	linear,
+	tiled_4x4,	// 4x4 texel tiles, a tile is 4 cache lines of float rgba
+	tiled_8x8,
+	morton,		// Z order, the bits of x and y interleaved (with BMI2's pdep when the build has it)
+};
+
+// one mip level of float rgba texels
+struct texture_level
+{
+	const float *texels;
+	int size[3];		// width, height, depth (1 unless 3D)
+	ptrdiff_t pitch[2];	// in bytes, between rows (of tiles when tiled, unused for morton) and between slices
+						// linear rows can go backwards with a negative pitch
+	texture_layout layout;
+	int bits;			// morton: how many low bits of x and y are interleaved, the rest of the longer axis goes on top
+};
+
+constexpr int max_texture_levels = 16;	// 32768 texels across
+
+namespace detail { namespace sampling {
+
+// floor() as an int without overflowing, NaN goes to the low end
+inline int floor_int(float x)
+{
+	constexpr float limit = 1 << 24;
+	x = x > -limit ? (x < limit ? x : limit) : -limit;
+	return static_cast<int>(std::floor(x));
+}
+
+inline int wrapped(int i, int n, wrap mode)
+{
+	if (static_cast<unsigned>(i) < static_cast<unsigned>(n)) { // the usual case, no division
+		return i;
+	}
+	switch (mode) {
+	case wrap::clamp:
+		return i < 0 ? 0 : i >= n ? n - 1 : i;
+	case wrap::mirror: {
+		const int period = 2 * n;
+		i %= period;
+		i = i < 0 ? i + period : i;
+		return i < n ? i : period - 1 - i;
+	}
+	default:
+		i %= n;
+		return i < 0 ? i + n : i;
+	}
+}
+
+// 0b1011 -> 0b1000101
+inline uint32_t spread_bits(uint32_t v)
+{
+#ifdef VML_SAMPLER_PDEP
+	return _pdep_u32(v, 0x55555555u);
+#else
+	v &= 0xffffu;
+	v = (v | (v << 8)) & 0x00ff00ffu;
+	v = (v | (v << 4)) & 0x0f0f0f0fu;
+	v = (v | (v << 2)) & 0x33333333u;
+	v = (v | (v << 1)) & 0x55555555u;
+	return v;
+#endif
+}
+
+template<texture_layout Layout>
+const float* texel_at(const texture_level &level, int x, int y, int z)
+{
+	const auto slice = reinterpret_cast<const uint8_t*>(level.texels) + z * level.pitch[1];
+	if constexpr (Layout == texture_layout::linear) {
+		return reinterpret_cast<const float*>(slice + y * level.pitch[0]) + x * 4;
+	} else if constexpr (Layout == texture_layout::morton) {
+		const uint32_t low = (1u << level.bits) - 1;
+		const uint32_t high = (static_cast<uint32_t>(x) >> level.bits) + (static_cast<uint32_t>(y) >> level.bits);
+		const uint32_t index = (spread_bits(x & low) | spread_bits(y & low) << 1) + (high << 2 * level.bits);
+		return reinterpret_cast<const float*>(slice) + static_cast<size_t>(index) * 4;
+	} else {
+		constexpr int bits = Layout == texture_layout::tiled_4x4 ? 2 : 3;
+		constexpr int mask = (1 << bits) - 1;
+		const int index = (x >> bits) << 2 * bits | (y & mask) << bits | (x & mask);
+		return reinterpret_cast<const float*>(slice + (y >> bits) * level.pitch[0]) + static_cast<size_t>(index) * 4;
+	}
+}
+
+// for what isn't per texel (fetches, building textures)
+inline const float* texel_at(const texture_level &level, int x, int y, int z)
+{
+	switch (level.layout) {
+	case texture_layout::tiled_4x4:
+		return texel_at<texture_layout::tiled_4x4>(level, x, y, z);
+	case texture_layout::tiled_8x8:
+		return texel_at<texture_layout::tiled_8x8>(level, x, y, z);
+	case texture_layout::morton:
+		return texel_at<texture_layout::morton>(level, x, y, z);
+	default:
+		return texel_at<texture_layout::linear>(level, x, y, z);
+	}
+}
+
+inline void lerp(const float *a, const float *b, float t, float *out)
+{
+	for (int c = 0; c < 4; ++c) {
+		out[c] = a[c] + (b[c] - a[c]) * t;
+	}
+}
+
+inline void copy(const float *texel, float *out)
+{
+	for (int c = 0; c < 4; ++c) {
+		out[c] = texel[c];
+	}
+}
+
+// p in texture coordinates, [0, 1) across the level
+template<int Dims, texture_layout Layout>
+void sample_level(const texture_level &level, const float *p, bool linear, wrap mode, float *out)
+{
+	int i0[3] = {}, i1[3] = {};
+	float t[3] = {};
+	for (int axis = 0; axis < Dims; ++axis) {
+		const int n = level.size[axis];
+		const float x = p[axis] * n - (linear ? .5f : 0.f);
+		const int i = floor_int(x);
+		t[axis] = x - i;
+		i0[axis] = wrapped(i, n, mode);
+		i1[axis] = linear ? wrapped(i + 1, n, mode) : i0[axis];
+	}
+
+	if (!linear) {
+		copy(texel_at<Layout>(level, i0[0], i0[1], i0[2]), out);
+		return;
+	}
+
+	// 4 texels per slice, a whole texel per lerp
+	alignas(16) float bottom[4], top[4];
+	lerp(texel_at<Layout>(level, i0[0], i0[1], i0[2]), texel_at<Layout>(level, i1[0], i0[1], i0[2]), t[0], bottom);
+	lerp(texel_at<Layout>(level, i0[0], i1[1], i0[2]), texel_at<Layout>(level, i1[0], i1[1], i0[2]), t[0], top);
+	lerp(bottom, top, t[1], out);
+
+	if constexpr (Dims == 3) {
+		alignas(16) float back[4];
+		lerp(texel_at<Layout>(level, i0[0], i0[1], i1[2]), texel_at<Layout>(level, i1[0], i0[1], i1[2]), t[0], bottom);
+		lerp(texel_at<Layout>(level, i0[0], i1[1], i1[2]), texel_at<Layout>(level, i1[0], i1[1], i1[2]), t[0], top);
+		lerp(bottom, top, t[1], back);
+		lerp(out, back, t[2], out);
+	}
+}
+
+// GL's cubemap face of a direction (+x, -x, +y, -y, +z, -z) and where on it, s and t in [0, 1]
+inline int cube_face(const float *d, float &s, float &t)
+{
+	const float ax = std::fabs(d[0]), ay = std::fabs(d[1]), az = std::fabs(d[2]);
+	int face;
+	float sc, tc, ma;
+	if (ax >= ay && ax >= az) {
+		face = d[0] >= 0.f ? 0 : 1;
+		sc = d[0] >= 0.f ? -d[2] : d[2];
+		tc = -d[1];
+		ma = ax;
+	} else if (ay >= az) {
+		face = d[1] >= 0.f ? 2 : 3;
+		sc = d[0];
+		tc = d[1] >= 0.f ? d[2] : -d[2];
+		ma = ay;
+	} else {
+		face = d[2] >= 0.f ? 4 : 5;
+		sc = d[2] >= 0.f ? d[0] : -d[0];
+		tc = -d[1];
+		ma = az;
+	}
+	const float scale = ma > 0.f ? .5f / ma : 0.f;
+	s = sc * scale + .5f;
+	t = tc * scale + .5f;
+	return face;
+}
+
+// the other way around, s and t can be past the edges of the face
+inline void cube_direction(int face, float s, float t, float *d)
+{
+	const float sc = 2.f * s - 1.f, tc = 2.f * t - 1.f;
+	const float directions[6][3] = {
+		{ 1.f, -tc, -sc }, { -1.f, -tc, sc }, { sc, 1.f, tc }, { sc, -1.f, -tc }, { sc, -tc, 1.f }, { -sc, -tc, -1.f }
+	};
+	for (int axis = 0; axis < 3; ++axis) {
+		d[axis] = directions[face][axis];
+	}
+}
+
+// texel (x, y) of a face, also one texel past its edges: then it is the texel of the next face the direction goes through
+template<texture_layout Layout>
+const float* cube_texel_at(const texture_level &level, int face, int x, int y)
+{
+	const int n = level.size[0];
+	if (static_cast<unsigned>(x) >= static_cast<unsigned>(n) || static_cast<unsigned>(y) >= static_cast<unsigned>(n)) {
+		float d[3], s, t;
+		cube_direction(face, (x + .5f) / n, (y + .5f) / n, d);
+		face = cube_face(d, s, t);
+		x = wrapped(floor_int(s * n), n, wrap::clamp);
+		y = wrapped(floor_int(t * n), n, wrap::clamp);
+	}
+	return texel_at<Layout>(level, x, y, face);
+}
+
+template<texture_layout Layout>
+void sample_cube_level(const texture_level &level, int face, float s, float t, bool linear, float *out)
+{
+	const int n = level.size[0];
+	if (!linear) {
+		copy(texel_at<Layout>(level, wrapped(floor_int(s * n), n, wrap::clamp), wrapped(floor_int(t * n), n, wrap::clamp), face),
+			out);
+		return;
+	}
+
+	const float x = s * n - .5f, y = t * n - .5f;
+	const int i = floor_int(x), j = floor_int(y);
+	const float tx = x - i, ty = y - j;
+	alignas(16) float bottom[4], top[4];
+	lerp(cube_texel_at<Layout>(level, face, i, j), cube_texel_at<Layout>(level, face, i + 1, j), tx, bottom);
+	lerp(cube_texel_at<Layout>(level, face, i, j + 1), cube_texel_at<Layout>(level, face, i + 1, j + 1), tx, top);
+	lerp(bottom, top, ty, out);
+}
+
+} } // namespace detail::sampling
+
+template<int Dims>
+class sampler
+{
+public:
+	static_assert(Dims == 2 || Dims == 3, "2D or 3D textures");
+
+	sampler() = default;	// nothing bound, reads as 0
+
+	// levels[0] is the base level, every one after it half the size of the one before, the texels aren't copied
+	sampler(const texture_level *levels, int count, sampler_state state = {})
+		: Count(count < max_texture_levels ? count : max_texture_levels), State(state)
+	{
+		for (int i = 0; i < Count; ++i) {
+			Levels[i] = levels[i];
+		}
+	}
+
+	bool bound() const { return Count > 0; }
+	int levels() const { return Count; }
+	const texture_level& level(int lod) const { return Levels[lod]; }
+	sampler_state state() const { return State; }
+
+	// texelFetch(), 0 outside of the level
+	void fetch(const int *p, int lod, float *out) const
+	{
+		bool inside = lod >= 0 && lod < Count;
+		for (int axis = 0; axis < Dims && inside; ++axis) {
+			inside = p[axis] >= 0 && p[axis] < Levels[lod].size[axis];
+		}
+		if (!inside) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			return;
+		}
+		detail::sampling::copy(detail::sampling::texel_at(Levels[lod], p[0], p[1], Dims == 3 ? p[2] : 0), out);
+	}
+
+	// filtered at that level of detail, p in texture coordinates
+	void sample(const float *p, float lod, float *out) const
+	{
+		if (!Count) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			return;
+		}
+
+		switch (Levels[0].layout) {
+		case texture_layout::tiled_4x4:
+			sample_with<texture_layout::tiled_4x4>(p, lod, out);
+			break;
+		case texture_layout::tiled_8x8:
+			sample_with<texture_layout::tiled_8x8>(p, lod, out);
+			break;
+		case texture_layout::morton:
+			sample_with<texture_layout::morton>(p, lod, out);
+			break;
+		default:
+			sample_with<texture_layout::linear>(p, lod, out);
+			break;
+		}
+	}
+
+	// what texture() samples at: log2 of the texels between neighbouring pixels, 0 outside of quads or without mips
+	float implicit_lod(const float *p) const
+	{
+		if (Count < 2) {
+			return 0.f;
+		}
+
+		float texels[Dims], dx[Dims], dy[Dims];
+		for (int axis = 0; axis < Dims; ++axis) {
+			texels[axis] = p[axis] * Levels[0].size[axis];
+		}
+		detail::quad::derivative(texels, dx, 1);
+		detail::quad::derivative(texels, dy, 2);
+
+		float x = 0.f, y = 0.f;
+		for (int axis = 0; axis < Dims; ++axis) {
+			x += dx[axis] * dx[axis];
+			y += dy[axis] * dy[axis];
+		}
+		const float rho2 = x > y ? x : y;
+		return rho2 > 0.f ? .5f * std::log2(rho2) : 0.f;
+	}
+
+private:
+	texture_level Levels[max_texture_levels] = {};
+	int Count = 0;
+	sampler_state State;
+
+	// all the levels have the layout of the first one
+	template<texture_layout Layout>
+	void sample_with(const float *p, float lod, float *out) const
+	{
+		const float top = static_cast<float>(Count - 1);
+		lod = lod > 0.f ? (lod < top ? lod : top) : 0.f;
+		const int base = static_cast<int>(lod);
+		const float blend = lod - base;
+
+		if (State.filtering == filter::trilinear && blend > 0.f) {
+			alignas(16) float next[4];
+			detail::sampling::sample_level<Dims, Layout>(Levels[base], p, true, State.wrapping, out);
+			detail::sampling::sample_level<Dims, Layout>(Levels[base + 1], p, true, State.wrapping, next);
+			detail::sampling::lerp(out, next, blend, out);
+		} else {
+			const int closest = blend > .5f ? base + 1 : base;
+			detail::sampling::sample_level<Dims, Layout>(Levels[closest], p, State.filtering != filter::nearest, State.wrapping, out);
+		}
+	}
+};
+
+using sampler2D = sampler<2>;
+using sampler3D = sampler<3>;
+
+class samplerCube
+{
+public:
+	samplerCube() = default;	// nothing bound, reads as 0
+
+	// every level is the six square faces as its slices (see cubemap_storage), the texels aren't copied
+	samplerCube(const texture_level *levels, int count, sampler_state state = {})
+		: Count(count < max_texture_levels ? count : max_texture_levels), State(state)
+	{
+		for (int i = 0; i < Count; ++i) {
+			Levels[i] = levels[i];
+		}
+	}
+
+	bool bound() const { return Count > 0; }
+	int levels() const { return Count; }
+	const texture_level& level(int lod) const { return Levels[lod]; }
+	sampler_state state() const { return State; }
+
+	// filtered at that level of detail, d a direction of any length
+	void sample(const float *d, float lod, float *out) const
+	{
+		if (!Count) {
+			out[0] = out[1] = out[2] = out[3] = 0.f;
+			return;
+		}
+
+		switch (Levels[0].layout) {
+		case texture_layout::tiled_4x4:
+			sample_with<texture_layout::tiled_4x4>(d, lod, out);
+			break;
+		case texture_layout::tiled_8x8:
+			sample_with<texture_layout::tiled_8x8>(d, lod, out);
+			break;
+		case texture_layout::morton:
+			sample_with<texture_layout::morton>(d, lod, out);
+			break;
+		default:
+			sample_with<texture_layout::linear>(d, lod, out);
+			break;
+		}
+	}
+
+	// like sampler's, from the direction projected on the cube so neighbouring pixels on different faces still agree
+	float implicit_lod(const float *d) const
+	{
+		if (Count < 2) {
+			return 0.f;
+		}
+
+		const float ma = std::max(std::fabs(d[0]), std::max(std::fabs(d[1]), std::fabs(d[2])));
+		const float scale = ma > 0.f ? .5f * Levels[0].size[0] / ma : 0.f;
+		float texels[3], dx[3], dy[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			texels[axis] = d[axis] * scale;
+		}
+		detail::quad::derivative(texels, dx, 1);
+		detail::quad::derivative(texels, dy, 2);
+
+		const float x = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+		const float y = dy[0] * dy[0] + dy[1] * dy[1] + dy[2] * dy[2];
+		const float rho2 = x > y ? x : y;
+		return rho2 > 0.f ? .5f * std::log2(rho2) : 0.f;
+	}
+
+private:
+	texture_level Levels[max_texture_levels] = {};
+	int Count = 0;
+	sampler_state State;
+
+	template<texture_layout Layout>
+	void sample_with(const float *d, float lod, float *out) const
+	{
+		float s, t;
+		const int face = detail::sampling::cube_face(d, s, t);
+
+		const float top = static_cast<float>(Count - 1);
+		lod = lod > 0.f ? (lod < top ? lod : top) : 0.f;
+		const int base = static_cast<int>(lod);
+		const float blend = lod - base;
+
+		if (State.filtering == filter::trilinear && blend > 0.f) {
+			alignas(16) float next[4];
+			detail::sampling::sample_cube_level<Layout>(Levels[base], face, s, t, true, out);
+			detail::sampling::sample_cube_level<Layout>(Levels[base + 1], face, s, t, true, next);
+			detail::sampling::lerp(out, next, blend, out);
+		} else {
+			const int closest = blend > .5f ? base + 1 : base;
+			detail::sampling::sample_cube_level<Layout>(Levels[closest], face, s, t, State.filtering != filter::nearest, out);
+		}
+	}
+};
+
+// owns float rgba texels and their mip chain
+template<int Dims>
+class texture_storage
+{
+public:
+	// size: width, height (and depth), texels: tightly packed rows of that format, row 0 is the bottom, nullptr for all 0
+	// mipmaps: the chain down to 1 texel, box filtered
+	// layers: 2D only, that many textures of the size one after the other, the slices of every level (see cubemap_storage)
+	texture_storage(const int (&size)[Dims], texel_format format, const void *texels, bool mipmaps = true,
+		texture_layout layout = texture_layout::linear, int layers = 1)
+		: Mipmaps(mipmaps)
+	{
+		int level_size[3] = { 1, 1, Dims == 2 && layers > 1 ? layers : 1 };
+		for (int axis = 0; axis < Dims; ++axis) {
+			level_size[axis] = size[axis] > 0 ? size[axis] : 1;
+		}
+
+		size_t offsets[max_texture_levels] = {}, total = 0;
+		for (Count = 0; Count < max_texture_levels; ++Count) {
+			auto &level = Levels[Count];
+			for (int axis = 0; axis < 3; ++axis) {
+				level.size[axis] = level_size[axis];
+			}
+			level.layout = layout;
+			lay_out(level);
+			offsets[Count] = total;
+			total += static_cast<size_t>(level.pitch[1] / sizeof(float)) * level_size[2];
+
+			if (!mipmaps || (level_size[0] == 1 && level_size[1] == 1 && (Dims == 2 || level_size[2] == 1))) {
+				++Count;
+				break;
+			}
+			for (int axis = 0; axis < Dims; ++axis) {
+				level_size[axis] = level_size[axis] > 1 ? level_size[axis] / 2 : 1;
+			}
+		}
+
+		Texels.assign(total, 0.f);
+		for (int i = 0; i < Count; ++i) {
+			Levels[i].texels = Texels.data() + offsets[i];
+		}
+
+		if (texels) {
+			convert(format, texels, Levels[0]);
+			generate_mipmaps();
+		}
+	}
+
+	// the texels stay where they are for the lifetime of the storage, so samplers can be made once and kept
+	sampler<Dims> bind(sampler_state state = {}) const
+	{
+		return sampler<Dims>(Levels, Count, state);
+	}
+
+	int levels() const { return Count; }
+	const texture_level& level(int lod) const { return Levels[lod]; }
+
+	// a texel of the base level to write into (bake, render to texture), generate_mipmaps() after
+	float* texel(int x, int y, int z = 0)
+	{
+		return const_cast<float*>(detail::sampling::texel_at(Levels[0], x, y, z));
+	}
+
+	void generate_mipmaps()
+	{
+		for (int i = 1; i < Count && Mipmaps; ++i) {
+			downsample(Levels[i - 1], Levels[i]);
+		}
+	}
+
+private:
+	std::vector<float> Texels;	// all the levels, the base one first
+	texture_level Levels[max_texture_levels] = {};
+	int Count = 0;
+	bool Mipmaps;
+
+	// pitches (and bits) of a level of that size, padded to whole tiles or powers of 2
+	static void lay_out(texture_level &level)
+	{
+		constexpr ptrdiff_t texel_bytes = 4 * sizeof(float);
+		const int width = level.size[0], height = level.size[1];
+		switch (level.layout) {
+		case texture_layout::tiled_4x4:
+		case texture_layout::tiled_8x8: {
+			const int tile = level.layout == texture_layout::tiled_4x4 ? 4 : 8;
+			level.pitch[0] = static_cast<ptrdiff_t>((width + tile - 1) / tile) * tile * tile * texel_bytes;
+			level.pitch[1] = level.pitch[0] * ((height + tile - 1) / tile);
+			break;
+		}
+		case texture_layout::morton: {
+			int bits_x = 0, bits_y = 0;
+			while ((1 << bits_x) < width) {
+				++bits_x;
+			}
+			while ((1 << bits_y) < height) {
+				++bits_y;
+			}
+			level.bits = std::min(bits_x, bits_y);
+			level.pitch[0] = 0;
+			level.pitch[1] = (static_cast<ptrdiff_t>(1) << (bits_x + bits_y)) * texel_bytes;
+			break;
+		}
+		default:
+			level.pitch[0] = width * texel_bytes;
+			level.pitch[1] = level.pitch[0] * height;
+			break;
+		}
+	}
+
+	template<int Channels, typename T>
+	static void convert(const T *src, const texture_level &level, float scale)
+	{
+		for (int z = 0; z < level.size[2]; ++z) {
+			for (int y = 0; y < level.size[1]; ++y) {
+				for (int x = 0; x < level.size[0]; ++x, src += Channels) {
+					auto dst = const_cast<float*>(detail::sampling::texel_at(level, x, y, z));
+					dst[0] = src[0] * scale;
+					dst[1] = Channels > 1 ? src[1 % Channels] * scale : 0.f;
+					dst[2] = Channels > 1 ? src[2 % Channels] * scale : 0.f;
+					dst[3] = Channels > 3 ? src[3 % Channels] * scale : 1.f;
+				}
+			}
+		}
+	}
+
+	// once per texture, not per texel
+	static void convert(texel_format format, const void *src, const texture_level &dst)
+	{
+		const auto bytes = static_cast<const uint8_t*>(src);
+		const auto floats = static_cast<const float*>(src);
+		switch (format) {
+		case texel_format::r8:
+			convert<1>(bytes, dst, 1.f / 255);
+			break;
+		case texel_format::rgb8:
+			convert<3>(bytes, dst, 1.f / 255);
+			break;
+		case texel_format::rgba8:
+			convert<4>(bytes, dst, 1.f / 255);
+			break;
+		case texel_format::r32f:
+			convert<1>(floats, dst, 1.f);
+			break;
+		case texel_format::rgb32f:
+			convert<3>(floats, dst, 1.f);
+			break;
+		case texel_format::rgba32f:
+			convert<4>(floats, dst, 1.f);
+			break;
+		}
+	}
+
+	// box filter, odd sizes repeat their last texel; the layers of a 2D texture stay apart
+	static void downsample(const texture_level &src, const texture_level &dst)
+	{
+		const int taps_z = Dims == 3 && src.size[2] > 1 ? 2 : 1;
+		const int taps_y = src.size[1] > 1 ? 2 : 1;
+		const int taps_x = src.size[0] > 1 ? 2 : 1;
+		const float weight = 1.f / (taps_x * taps_y * taps_z);
+
+		for (int z = 0; z < dst.size[2]; ++z) {
+			for (int y = 0; y < dst.size[1]; ++y) {
+				for (int x = 0; x < dst.size[0]; ++x) {
+					auto out = const_cast<float*>(detail::sampling::texel_at(dst, x, y, z));
+					alignas(16) float sum[4] = {};
+					for (int dz = 0; dz < taps_z; ++dz) {
+						for (int dy = 0; dy < taps_y; ++dy) {
+							for (int dx = 0; dx < taps_x; ++dx) {
+								const auto texel = detail::sampling::texel_at(src,
+									std::min(2 * x + dx, src.size[0] - 1),
+									std::min(2 * y + dy, src.size[1] - 1),
+									Dims == 3 ? std::min(2 * z + dz, src.size[2] - 1) : z);
+								for (int c = 0; c < 4; ++c) {
+									sum[c] += texel[c];
+								}
+							}
+						}
+					}
+					for (int c = 0; c < 4; ++c) {
+						out[c] = sum[c] * weight;
+					}
+				}
+			}
+		}
+	}
+};
+
+// six square faces in GL's order: +x, -x, +y, -y, +z, -z
+// face texel (x, y) is where cube_direction() of ((x + .5) / size, (y + .5) / size) goes through
+class cubemap_storage
+{
+public:
+	// faces: all six one after the other, tightly packed rows of that format, nullptr for all 0
+	cubemap_storage(int size, texel_format format, const void *faces, bool mipmaps = true,
+		texture_layout layout = texture_layout::linear)
+		: Faces({ size, size }, format, faces, mipmaps, layout, 6)
+	{}
+
+	samplerCube bind(sampler_state state = {}) const
+	{
+		return samplerCube(&Faces.level(0), Faces.levels(), state);
+	}
+
+	int size() const { return Faces.level(0).size[0]; }
+	int levels() const { return Faces.levels(); }
+	const texture_level& level(int lod) const { return Faces.level(lod); }
+
+	// a texel of the base level to write into (bake), generate_mipmaps() after
+	float* texel(int face, int x, int y) { return Faces.texel(x, y, face); }
+
+	void generate_mipmaps() { Faces.generate_mipmaps(); }
+
+private:
+	texture_storage<2> Faces;
+};
+
+// GLSL
+// the coordinates are taken by value so swizzles (uv.xy) convert
+
+inline vector<float, 0, 1, 2, 3> texture(const sampler2D &s, vector<float, 0, 1> uv, float bias = 0.f)
+{
+	const float p[2] = { uv.x, uv.y };
+	alignas(16) float out[4];
+	s.sample(p, s.implicit_lod(p) + bias, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> texture(const sampler3D &s, vector<float, 0, 1, 2> uvw, float bias = 0.f)
+{
+	const float p[3] = { uvw.x, uvw.y, uvw.z };
+	alignas(16) float out[4];
+	s.sample(p, s.implicit_lod(p) + bias, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> texture(const samplerCube &s, vector<float, 0, 1, 2> direction, float bias = 0.f)
+{
+	const float d[3] = { direction.x, direction.y, direction.z };
+	alignas(16) float out[4];
+	s.sample(d, s.implicit_lod(d) + bias, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> textureLod(const sampler2D &s, vector<float, 0, 1> uv, float lod)
+{
+	const float p[2] = { uv.x, uv.y };
+	alignas(16) float out[4];
+	s.sample(p, lod, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> textureLod(const sampler3D &s, vector<float, 0, 1, 2> uvw, float lod)
+{
+	const float p[3] = { uvw.x, uvw.y, uvw.z };
+	alignas(16) float out[4];
+	s.sample(p, lod, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> textureLod(const samplerCube &s, vector<float, 0, 1, 2> direction, float lod)
+{
+	const float d[3] = { direction.x, direction.y, direction.z };
+	alignas(16) float out[4];
+	s.sample(d, lod, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> texelFetch(const sampler2D &s, vector<int, 0, 1> xy, int lod)
+{
+	const int p[2] = { xy.x, xy.y };
+	alignas(16) float out[4];
+	s.fetch(p, lod, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<float, 0, 1, 2, 3> texelFetch(const sampler3D &s, vector<int, 0, 1, 2> xyz, int lod)
+{
+	const int p[3] = { xyz.x, xyz.y, xyz.z };
+	alignas(16) float out[4];
+	s.fetch(p, lod, out);
+	return vector<float, 0, 1, 2, 3>(out[0], out[1], out[2], out[3]);
+}
+
+inline vector<int, 0, 1> textureSize(const sampler2D &s, int lod)
+{
+	const bool valid = lod >= 0 && lod < s.levels();
+	return vector<int, 0, 1>(valid ? s.level(lod).size[0] : 0, valid ? s.level(lod).size[1] : 0);
+}
+
+inline vector<int, 0, 1, 2> textureSize(const sampler3D &s, int lod)
+{
+	const bool valid = lod >= 0 && lod < s.levels();
+	return vector<int, 0, 1, 2>(valid ? s.level(lod).size[0] : 0, valid ? s.level(lod).size[1] : 0,
+		valid ? s.level(lod).size[2] : 0);
+}
+
+// of a face
+inline vector<int, 0, 1> textureSize(const samplerCube &s, int lod)
+{
+	const bool valid = lod >= 0 && lod < s.levels();
+	return vector<int, 0, 1>(valid ? s.level(lod).size[0] : 0, valid ? s.level(lod).size[1] : 0);
+}
+
+inline int textureQueryLevels(const sampler2D &s) { return s.levels(); }
+inline int textureQueryLevels(const sampler3D &s) { return s.levels(); }
+inline int textureQueryLevels(const samplerCube &s) { return s.levels(); }
+
+} // namespace vml
@@ -0,0 +1,4 @@
+#pragma once
+
+// For the CPU, the texels are plain memory
+#include "../sampler.h"
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
@@ -8,6 +9,7 @@
 #include "detail/functions.h"
 #include "detail/binary_ops.h"
 #include "detail/vector_base.h"
+#include "detail/constant.h"
 
 namespace vml {
 
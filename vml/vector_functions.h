@@ -70,4 +70,55 @@ MAKE_LIB_FUNC(dFdx)
 MAKE_LIB_FUNC(dFdy)
 MAKE_LIB_FUNC(fwidth)
 
-#undef MAKE_LIB_FUNC
\ No newline at end of file
+#undef MAKE_LIB_FUNC
+
+// compile time constants (see detail/constant.h) are strength reduced
+// the generic versions above drop out since vml::c can't be promoted to a vector
+template<class X, intmax_t N, intmax_t D, bool I>
+inline auto pow(X&& x, ::vml::c<N, D, I> y) -> typename ::vml::detail::remove_cvref<decltype(::vml::detail::decay(std::forward<X>(x)))>::type
+{
+	using vec = typename ::vml::traits::promote_to_vec<X>::type;
+	using scalar = typename vec::scalar_type;
+
+	if constexpr (D == 1 && N >= -16 && N <= 16) {
+		return vec::template lib_pown<N>(std::forward<X>(x));
+	} else if constexpr (N == 1 && D == 2) {
+		return vec::lib_sqrt(std::forward<X>(x));
+	} else if constexpr (N == -1 && D == 2) {
+		return vec::lib_inversesqrt(std::forward<X>(x));
+	} else {
+		return vec::lib_pow(std::forward<X>(x), vec(scalar(y)));
+	}
+}
+
+template<intmax_t N, intmax_t D, bool I, class Y>
+inline auto pow(::vml::c<N, D, I> x, Y&& y) -> typename ::vml::detail::remove_cvref<decltype(::vml::detail::decay(std::forward<Y>(y)))>::type
+{
+	using vec = typename ::vml::traits::promote_to_vec<Y>::type;
+	using scalar = typename vec::scalar_type;
+
+	if constexpr (N == 2 && D == 1) {
+		return vec::lib_exp2(std::forward<Y>(y));
+	} else {
+		return vec::lib_pow(vec(scalar(x)), std::forward<Y>(y));
+	}
+}
+
+template<class X, intmax_t N, intmax_t D, bool I>
+inline auto mod(X&& x, ::vml::c<N, D, I>) -> typename ::vml::detail::remove_cvref<decltype(::vml::detail::decay(std::forward<X>(x)))>::type
+{
+	using vec = typename ::vml::traits::promote_to_vec<X>::type;
+	using scalar = typename vec::scalar_type;
+	constexpr auto y = scalar(N) / scalar(D);
+	constexpr auto y_rcp = scalar(D) / scalar(N);
+	constexpr intmax_t n = (N < 0 ? -N : N) / ::vml::detail::gcd(N, D), d = (D < 0 ? -D : D) / ::vml::detail::gcd(N, D);
+
+	// the reciprocal is only exact for powers of 2, a rounded one (ex: 1/3) can floor to the wrong side
+	// near multiples of y and give a result below 0 or about y, which GLSL's mod never does
+	const auto v = ::vml::detail::decay(std::forward<X>(x));
+	if constexpr (::vml::detail::is_pow2<n> && ::vml::detail::is_pow2<d>) {
+		return v - y * vec::lib_floor(v * y_rcp);
+	} else {
+		return v - y * vec::lib_floor(v / y);
+	}
+}
\ No newline at end of file